@@ -320,6 +320,33 @@ config_string(
 config_option(
     KernelDomainMicroarchFlush DOMAIN_MICROARCH_FLUSH "Enable determinisation (by flushing or other means) of microarchitectural state and related timing effects on domain switch"
     DEFAULT OFF
+    DEPENDS "KernelArchRiscV"
+)
+
+config_option(
+    KernelDomainSwitchPad DOMAIN_SWITCH_PAD "Pad each domain switch to the number of cycles after \
+    the timer interrupt given by the pad field of its domain schedule entry. With tracepoints, \
+    the first two domain switch trace points record the switch latency before and after the pad."
+    DEFAULT OFF
+    DEPENDS "KernelDomainMicroarchFlush;KernelArchRiscV"
+)
+
+config_string(
+    KernelDomainSwitchTracePoint DOMAIN_SWITCH_TRACE_POINT "The first of the trace points \
+    recording domain switches: the switch latency before and after the pad, then the cycles \
+    spent touching the shared kernel data. Each is recorded only if it fits below \
+    KernelMaxNumTracePoints, so keep them clear of the trace points used elsewhere."
+    DEFAULT 0
+    DEPENDS "KernelDomainMicroarchFlush;KernelBenchmarksTracepoints"
+    UNQUOTE
+)
+
+config_string(
+    KernelDomainSwitchPadCSR DOMAIN_SWITCH_PAD_CSR "The CSR number of cspad, the register setting \
+    how long fence.t waits after the timer interrupt. It depends on the core build."
+    DEFAULT 0x5c0
+    DEPENDS "KernelDomainSwitchPad"
+    UNQUOTE
 )
 
 config_string(
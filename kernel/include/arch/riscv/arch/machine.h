@@ -137,11 +137,25 @@ static inline void fencet(void)
      * specified by Nils Wistoff via private communication. */
     asm volatile (".word 0xfffff00b");
 }
+
+#ifdef CONFIG_DOMAIN_SWITCH_PAD
+static inline void write_cspad(word_t cycles)
+{
+    asm volatile("csrw " STRINGIFY(CONFIG_DOMAIN_SWITCH_PAD_CSR) ", %0" :: "r"(cycles));
+}
+#endif
 #else
 static inline void fencet(void)
 {
     /* do nothing */
 }
+
+#ifdef CONFIG_DOMAIN_SWITCH_PAD
+static inline void write_cspad(word_t cycles)
+{
+    /* do nothing */
+}
+#endif
 #endif
 
 word_t PURE getRestartPC(tcb_t *thread);
@@ -158,6 +172,13 @@ static inline void write_satp(word_t value)
     asm volatile("csrw satp, %0" :: "rK"(value));
 }
 
+static inline word_t read_satp(void)
+{
+    word_t temp;
+    asm volatile("csrr %0, satp" : "=r"(temp));
+    return temp;
+}
+
 static inline void write_stvec(word_t value)
 {
     asm volatile("csrw stvec, %0" :: "rK"(value));
@@ -253,6 +274,20 @@ static inline void setVSpaceRoot(paddr_t addr, asid_t asid)
 
     write_satp(satp.words[0]);
 
+#ifdef CONFIG_RISCV_ASID_TLB
+    /* TLB entries are tagged with their ASID, so within a domain nothing
+     * is flushed: an ASID's stale entries are already dropped when it is
+     * deleted or a mapping is removed. Other domains never see the
+     * translations this one cached. A hart without enough ASID bits stays
+     * at RISCV_TLB_DOMAIN_NONE, and so always flushes. */
+    if (likely(ARCH_NODE_STATE(riscvKSTLBDomain) == ksCurDomain)) {
+        return;
+    }
+    if (likely(ARCH_NODE_STATE(riscvKSASIDTLB))) {
+        ARCH_NODE_STATE(riscvKSTLBDomain) = ksCurDomain;
+    }
+#endif
+
     /* Order read/write operations */
 #ifdef ENABLE_SMP_SUPPORT
     sfence_local();
@@ -296,14 +331,22 @@ static inline exception_t Arch_setTLSRegister(word_t tls_base)
 #ifdef CONFIG_DOMAIN_MICROARCH_FLUSH
 static inline void arch_domainswitch_flush(void)
 {
-    /* Determinisation of off-core state for shared kernel data addresses. */
-    /* TODO: Enumerate shared kernel data addresses and implement this. */
+    /* Determinisation of off-core state for shared kernel data addresses
+     * is done by domainswitch_touch() just before. */
 
-    /* On-core state flush and time pad. */
-    /* TODO: Configure cspad register so fence.t will wait until that number
-     * of cycles after the arrival of the timer interrupt. */
+    /* On-core state flush and time pad, up to the cycles set by
+     * arch_domainswitch_pad(). */
     fencet();
 }
 #endif
 
+#ifdef CONFIG_DOMAIN_SWITCH_PAD
+/* Make the next fence.t wait until this number of cycles after the arrival
+ * of the timer interrupt. */
+static inline void arch_domainswitch_pad(word_t cycles)
+{
+    write_cspad(cycles);
+}
+#endif
+
 #endif // __ASSEMBLER__
@@ -20,8 +20,19 @@ NODE_STATE_BEGIN(archNodeState)
 /* TODO: add RISCV-dependent fields here */
 /* Bitmask of all cores should receive the reschedule IPI */
 NODE_STATE_DECLARE(word_t, ipiReschedulePending);
+#ifdef CONFIG_RISCV_ASID_TLB
+/* The domain whose translations the TLB may hold, or RISCV_TLB_DOMAIN_NONE
+ * to flush on the next address space switch */
+NODE_STATE_DECLARE(dom_t, riscvKSTLBDomain);
+/* Whether this hart tags TLB entries with every ASID bit the kernel uses */
+NODE_STATE_DECLARE(bool_t, riscvKSASIDTLB);
+#endif
 NODE_STATE_END(archNodeState);
 
+#ifdef CONFIG_RISCV_ASID_TLB
+#define RISCV_TLB_DOMAIN_NONE CONFIG_NUM_DOMAINS
+#endif
+
 extern asid_pool_t *riscvKSASIDTable[BIT(asidHighBits)];
 #ifdef CONFIG_KERNEL_IMAGES
 /* The reserved ASID pool for kernel images */
@@ -72,6 +72,38 @@ static inline void trace_point_stop(word_t id)
     }
 }
 
+/* Log a measurement taken elsewhere, for paths that must not write the log
+ * until they are done. */
+static inline void trace_point_log(word_t id, timestamp_t cycles)
+{
+    benchmark_tracepoint_log_entry_t *ksLog = (benchmark_tracepoint_log_entry_t *) KS_LOG_PPTR;
+
+    if (likely(ksUserLogBuffer != 0)) {
+        if (likely(ksLogIndex < MAX_LOG_SIZE)) {
+            ksLog[ksLogIndex] = (benchmark_tracepoint_log_entry_t) {
+                id, cycles
+            };
+        }
+        ksLogIndex++;
+        /* If this fails integer overflow has occurred. */
+        assert(ksLogIndex > 0);
+    }
+}
+
+#ifdef CONFIG_DOMAIN_MICROARCH_FLUSH
+/* The latency of a domain switch, from the start of the switch up to the
+ * time pad and to the end of it, and the cycles it spends touching the
+ * shared kernel data. The switch logs these only after its flush. */
+#if defined(CONFIG_DOMAIN_SWITCH_PAD) && \
+    CONFIG_MAX_NUM_TRACE_POINTS > CONFIG_DOMAIN_SWITCH_TRACE_POINT + 1
+#define TRACE_POINT_DOMAIN_SWITCH        CONFIG_DOMAIN_SWITCH_TRACE_POINT
+#define TRACE_POINT_DOMAIN_SWITCH_PADDED (CONFIG_DOMAIN_SWITCH_TRACE_POINT + 1)
+#endif
+#if CONFIG_MAX_NUM_TRACE_POINTS > CONFIG_DOMAIN_SWITCH_TRACE_POINT + 2
+#define TRACE_POINT_DOMAIN_SWITCH_TOUCH  (CONFIG_DOMAIN_SWITCH_TRACE_POINT + 2)
+#endif
+#endif /* CONFIG_DOMAIN_MICROARCH_FLUSH */
+
 #else
 
 #define TRACE_POINT_START(x)
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <config.h>
+#include <types.h>
+#include <arch/machine/hardware.h>
+#include <model/statedata.h>
+
+#ifdef CONFIG_DOMAIN_MICROARCH_FLUSH
+
+/* The kernel data on the domain switch path that is shared between the
+ * domains, kept as ranges of cache lines in address order. Touching all of
+ * them in that order on every switch leaves the off-core caches holding the
+ * same kernel lines whichever domain ran before. Each node has its own set,
+ * as it switches using its own scheduler state. */
+#define DOMAIN_SWITCH_TOUCH_RANGES 24
+
+typedef struct domain_switch_range {
+    vptr_t dsrStart;
+    word_t dsrLines;
+} domain_switch_range_t;
+
+extern domain_switch_range_t ksDomainSwitchTouch[CONFIG_MAX_NUM_NODES][DOMAIN_SWITCH_TOUCH_RANGES];
+extern word_t ksDomainSwitchTouchRanges[CONFIG_MAX_NUM_NODES];
+
+/* Build the set of the current node. Fails if it needs too many ranges. */
+bool_t domainswitch_touch_init(void);
+
+static inline void domainswitch_touch(void)
+{
+    domain_switch_range_t *ranges = ksDomainSwitchTouch[CURRENT_CPU_INDEX()];
+    word_t nranges = ksDomainSwitchTouchRanges[CURRENT_CPU_INDEX()];
+
+    for (word_t i = 0; i < nranges; i++) {
+        vptr_t line = ranges[i].dsrStart;
+        for (word_t j = 0; j < ranges[i].dsrLines; j++) {
+            (void)*(volatile word_t *)line;
+            line += L1_CACHE_LINE_SIZE;
+        }
+    }
+}
+
+#endif /* CONFIG_DOMAIN_MICROARCH_FLUSH */
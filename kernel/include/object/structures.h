@@ -33,6 +33,11 @@ typedef word_t irq_state_t;
 typedef struct dschedule {
     dom_t domain;
     word_t length;
+#ifdef CONFIG_DOMAIN_SWITCH_PAD
+    /* cycles after the timer interrupt at which the switch to this entry
+     * completes, 0 for no padding */
+    word_t pad;
+#endif
 #ifdef CONFIG_DOMAIN_IRQ_PARTITIONING
     irq_t irqs[CONFIG_MAX_NUM_DIRQS];
 #endif
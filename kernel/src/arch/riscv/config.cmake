@@ -27,6 +27,15 @@ config_option(
     DEPENDS "KernelArchRiscV"
 )
 
+config_option(
+    KernelRiscvASIDTLB RISCV_ASID_TLB "Keep the TLB when switching address spaces within a \
+    domain, relying on the ASID tags of its entries. The whole TLB is still flushed when the \
+    domain or the kernel image changes. Harts whose satp does not implement every ASID bit \
+    the kernel uses are detected at boot, and flush on every switch."
+    DEFAULT OFF
+    DEPENDS "KernelArchRiscV"
+)
+
 # Until RISC-V has instructions to count leading/trailing zeros, we provide
 # library implementations. Platforms that implement the bit manipulation
 # extension can override these settings to remove the library functions from
@@ -22,6 +22,7 @@
 #ifdef CONFIG_KERNEL_IMAGES
 #include <object/kernelimage.h>
 #endif
+#include <kernel/domainswitch.h>
 
 #ifdef ENABLE_SMP_SUPPORT
 BOOT_BSS static volatile word_t node_boot_lock;
@@ -125,9 +126,36 @@ BOOT_CODE static void init_fpu(void)
 }
 #endif
 
+#ifdef CONFIG_RISCV_ASID_TLB
+/* Only keep the TLB across address space switches if this hart implements
+ * every ASID bit the kernel hands out, so that no two address spaces share
+ * a tag. The first switch, to the kernel's own page table, always flushes. */
+BOOT_CODE static void init_asid_tlb(void)
+{
+    satp_t satp = { .words = { read_satp() } };
+    satp_t probe = satp;
+    word_t asid;
+
+    write_satp(satp_set_asid(probe, asidMax).words[0]);
+    probe.words[0] = read_satp();
+    write_satp(satp.words[0]);
+    asid = satp_get_asid(probe);
+
+    ARCH_NODE_STATE(riscvKSASIDTLB) = asid == asidMax;
+    ARCH_NODE_STATE(riscvKSTLBDomain) = RISCV_TLB_DOMAIN_NONE;
+    if (!ARCH_NODE_STATE(riscvKSASIDTLB)) {
+        printf("ASID TLB disabled: satp.ASID reads back %lx, not %lx\n",
+               (unsigned long)asid, (unsigned long)asidMax);
+    }
+}
+#endif
+
 BOOT_CODE static void init_cpu(void)
 {
 
+#ifdef CONFIG_RISCV_ASID_TLB
+    init_asid_tlb();
+#endif
     activate_kernel_vspace();
     /* Write trap entry address to stvec */
     write_stvec((word_t)trap_entry);
@@ -165,6 +193,11 @@ BOOT_CODE static bool_t try_init_kernel_secondary_core(word_t hart_id, word_t co
     clock_sync_test();
     ksNumCPUs++;
     init_core_state(SchedulerAction_ResumeCurrentThread);
+#ifdef CONFIG_DOMAIN_MICROARCH_FLUSH
+    if (!domainswitch_touch_init()) {
+        return false;
+    }
+#endif
     ifence_local();
     return true;
 }
@@ -539,6 +572,12 @@ static BOOT_CODE bool_t try_init_kernel(
 
     init_core_state(initial);
 
+#ifdef CONFIG_DOMAIN_MICROARCH_FLUSH
+    if (!domainswitch_touch_init()) {
+        return false;
+    }
+#endif
+
     /* convert the remaining free memory into UT objects and provide the caps */
     if (!create_untypeds(
             root_cnode_cap,
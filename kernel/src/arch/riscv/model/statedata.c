@@ -14,6 +14,11 @@
 #include <linker.h>
 #include <plat/machine/hardware.h>
 
+#ifdef CONFIG_RISCV_ASID_TLB
+UP_STATE_DEFINE(dom_t, riscvKSTLBDomain);
+UP_STATE_DEFINE(bool_t, riscvKSASIDTLB);
+#endif
+
 /* The top level asid mapping table */
 asid_pool_t *riscvKSASIDTable[BIT(asidHighBits)];
 #ifdef CONFIG_KERNEL_IMAGES
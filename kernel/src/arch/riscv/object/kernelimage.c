@@ -217,6 +217,11 @@ void Arch_setKernelImage(kernel_image_t *image)
     }
 
     //printf("    Arch_setKernelImage: Calling setVSpaceRoot for %lx (from %p), asid %lu.\n", kiRootPAddr, image->kiRoot, image->kiASID);
+#ifdef CONFIG_RISCV_ASID_TLB
+    /* The kernel image mappings are global, so their ASID tag doesn't keep
+     * them apart: always flush when switching images. */
+    ARCH_NODE_STATE(riscvKSTLBDomain) = RISCV_TLB_DOMAIN_NONE;
+#endif
     setVSpaceRoot(kiRootPAddr, image->kiASID);
     //printf("    Arch_setKernelImage: Returned from setVSpaceRoot for %lx (from %p), asid %lu.\n", kiRootPAddr, image->kiRoot, image->kiASID);
 
@@ -49,3 +49,4 @@ add_sources(
         src/kernel/sporadic.c
 )
 add_sources(DEP KernelImages CFILES src/object/kernelimage.c)
+add_sources(DEP "KernelDomainMicroarchFlush;KernelArchRiscV" CFILES src/kernel/domainswitch.c)
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <config.h>
+#include <types.h>
+#include <util.h>
+#include <assert.h>
+#include <machine/io.h>
+#include <model/statedata.h>
+#include <kernel/domainswitch.h>
+#ifdef CONFIG_KERNEL_IMAGES
+#include <object/kernelimage.h>
+#endif
+
+domain_switch_range_t ksDomainSwitchTouch[CONFIG_MAX_NUM_NODES][DOMAIN_SWITCH_TOUCH_RANGES];
+word_t ksDomainSwitchTouchRanges[CONFIG_MAX_NUM_NODES];
+
+/* Add the lines of an object to the touch set of the current node, keeping
+ * the ranges sorted and merging those that overlap or meet. Fails if there
+ * is no room for another range. */
+BOOT_CODE static bool_t domainswitch_touch_add(const void *object, word_t size)
+{
+    domain_switch_range_t *ranges = ksDomainSwitchTouch[CURRENT_CPU_INDEX()];
+    word_t *nranges = &ksDomainSwitchTouchRanges[CURRENT_CPU_INDEX()];
+    vptr_t start = ROUND_DOWN((vptr_t)object, L1_CACHE_LINE_SIZE_BITS);
+    vptr_t end = ROUND_UP((vptr_t)object + size, L1_CACHE_LINE_SIZE_BITS);
+    word_t i, j;
+
+    /* the first range ending at or after the start */
+    for (i = 0; i < *nranges; i++) {
+        domain_switch_range_t *r = &ranges[i];
+        if (r->dsrStart + r->dsrLines * L1_CACHE_LINE_SIZE >= start) {
+            break;
+        }
+    }
+
+    /* swallow every range starting at or before the end */
+    for (j = i; j < *nranges && ranges[j].dsrStart <= end; j++) {
+        domain_switch_range_t *r = &ranges[j];
+        start = MIN(start, r->dsrStart);
+        end = MAX(end, r->dsrStart + r->dsrLines * L1_CACHE_LINE_SIZE);
+    }
+
+    if (i == j) {
+        /* nothing merged, make room */
+        if (*nranges == DOMAIN_SWITCH_TOUCH_RANGES) {
+            return false;
+        }
+        for (j = *nranges; j > i; j--) {
+            ranges[j] = ranges[j - 1];
+        }
+        (*nranges)++;
+        j = i + 1;
+    } else {
+        /* ranges i + 1 to j - 1 are merged into i */
+        word_t k;
+        for (k = 0; j + k < *nranges; k++) {
+            ranges[i + 1 + k] = ranges[j + k];
+        }
+        *nranges = i + 1 + k;
+    }
+
+    ranges[i].dsrStart = start;
+    ranges[i].dsrLines = (end - start) >> L1_CACHE_LINE_SIZE_BITS;
+    return true;
+}
+
+#define TOUCH_RANGE(p, size) ok = domainswitch_touch_add(p, size) && ok
+#define TOUCH(x) TOUCH_RANGE(&(x), sizeof(x))
+
+/* The shared data read or written between the timer interrupt and the
+ * return to the new domain. The ready queues themselves are left out: which
+ * of them the switch reads depends on the threads of the incoming domain. */
+BOOT_CODE bool_t domainswitch_touch_init(void)
+{
+    word_t lines = 0, nranges;
+    bool_t ok = true;
+
+    /* read by nextDomain */
+    TOUCH_RANGE(ksDomSchedule, sizeof(dschedule_t) * ksDomScheduleLength);
+    TOUCH(ksDomScheduleLength);
+    TOUCH(ksDomScheduleIdx);
+    TOUCH(ksCurDomain);
+    TOUCH(ksDomainTime);
+    TOUCH(ksWorkUnitsCompleted);
+    TOUCH(NODE_STATE(ksCurThread));
+    TOUCH(NODE_STATE(ksIdleThread));
+    TOUCH(NODE_STATE(ksSchedulerAction));
+    TOUCH(NODE_STATE(ksReadyQueuesL1Bitmap));
+    TOUCH(NODE_STATE(ksReadyQueuesL2Bitmap));
+#ifdef CONFIG_KERNEL_MCS
+    TOUCH(NODE_STATE(ksReprogram));
+    TOUCH(NODE_STATE(ksCurSC));
+    TOUCH(NODE_STATE(ksReleaseHead));
+    TOUCH(NODE_STATE(ksConsumed));
+    TOUCH(NODE_STATE(ksCurTime));
+#endif
+#ifdef CONFIG_KERNEL_IMAGES
+    TOUCH_RANGE(ksDomKernelImage, sizeof(kernel_image_t) * CONFIG_NUM_DOMAINS);
+    TOUCH(NODE_STATE(ksCurKernelImage));
+    /* the code that switches the kernel image */
+    TOUCH_RANGE(ki_switch_start, ki_switch_end - ki_switch_start);
+#endif
+
+    if (!ok) {
+        printf("ERROR: domain switch touch set needs more than %d ranges\n",
+               (int)DOMAIN_SWITCH_TOUCH_RANGES);
+        return false;
+    }
+
+    nranges = ksDomainSwitchTouchRanges[CURRENT_CPU_INDEX()];
+    for (word_t i = 0; i < nranges; i++) {
+        lines += ksDomainSwitchTouch[CURRENT_CPU_INDEX()][i].dsrLines;
+    }
+    printf("Domain switch touches %lu lines in %lu ranges on node %lu\n",
+           (unsigned long)lines, (unsigned long)nranges,
+           (unsigned long)CURRENT_CPU_INDEX());
+    return true;
+}
@@ -20,6 +20,8 @@
 #include <arch/kernel/thread.h>
 #include <machine/registerset.h>
 #include <linker.h>
+#include <benchmark/benchmark.h>
+#include <kernel/domainswitch.h>
 
 static seL4_MessageInfo_t
 transferCaps(seL4_MessageInfo_t info,
@@ -346,6 +348,12 @@ static void scheduleChooseNewThread(void)
 #ifdef CONFIG_KERNEL_IMAGES
         exception_t status;
 #endif
+#ifdef TRACE_POINT_DOMAIN_SWITCH
+        timestamp_t switch_start = timestamp(), switch_unpadded, switch_end;
+#endif
+#ifdef TRACE_POINT_DOMAIN_SWITCH_TOUCH
+        timestamp_t touch_start, touch_end;
+#endif
 #ifdef CONFIG_DOMAIN_IRQ_PARTITIONING
         /* TODO: determine if we really do need, for verification reasons,
          * to delay the masking off of the old domain's irqs until after the
@@ -370,8 +378,33 @@ static void scheduleChooseNewThread(void)
 #ifdef CONFIG_DOMAIN_IRQ_PARTITIONING
         maskInterrupts(false, ksDomSchedule[ksDomScheduleIdx].irqs);
 #endif
+#ifdef CONFIG_DOMAIN_SWITCH_PAD
+        arch_domainswitch_pad(ksDomSchedule[ksDomScheduleIdx].pad);
+#endif
 #ifdef CONFIG_DOMAIN_MICROARCH_FLUSH
+#ifdef TRACE_POINT_DOMAIN_SWITCH_TOUCH
+        touch_start = timestamp();
+#endif
+        domainswitch_touch();
+#ifdef TRACE_POINT_DOMAIN_SWITCH_TOUCH
+        touch_end = timestamp();
+#endif
+#ifdef TRACE_POINT_DOMAIN_SWITCH
+        switch_unpadded = timestamp();
+#endif
         arch_domainswitch_flush();
+#ifdef TRACE_POINT_DOMAIN_SWITCH
+        switch_end = timestamp();
+#endif
+        /* Only write the log now, so that it is not part of the state the
+         * touch and flush make deterministic. */
+#ifdef TRACE_POINT_DOMAIN_SWITCH
+        trace_point_log(TRACE_POINT_DOMAIN_SWITCH, switch_unpadded - switch_start);
+        trace_point_log(TRACE_POINT_DOMAIN_SWITCH_PADDED, switch_end - switch_start);
+#endif
+#ifdef TRACE_POINT_DOMAIN_SWITCH_TOUCH
+        trace_point_log(TRACE_POINT_DOMAIN_SWITCH_TOUCH, touch_end - touch_start);
+#endif
 #endif
     }
     chooseThread();
@@ -17,6 +17,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <sel4/sel4.h>
 #include <sel4utils/vspace.h>
 #include <sel4utils/process.h>
@@ -24,36 +25,163 @@
 #include <vka/object.h>
 #include <vka/capops.h>
 #include <simple/simple.h>
+#include <libfdt.h>
 
 #include "manager.h"
+#ifdef MANAGER_DOMAIN_SWITCH_TRACE
+#include <sel4bench/kernel_logging.h>
+#endif
 #include <channel-bench/bench_types.h>
 
 #ifdef  CONFIG_MANAGER_COVERT_BENCH
 
+/*maximum number of experiments in a test plan*/
+#define COVERT_PLAN_MAX   64
+
+/*one covert channel experiment: a trojan and spy pair*/
+typedef struct {
+    seL4_Word trojan;     /*test numbers*/
+    seL4_Word spy;
+    int points;           /*data points recorded by the spy*/
+    bool mitigation;      /*seperate kernel images and cache colours*/
+} covert_exp_t;
+
 /*the benchmarking enviornment for two threads*/
 static bench_thread_t trojan, spy;
 
 /*ep for syn and reply*/
 static vka_object_t syn_ep, t_ep, s_ep;
 
+/*experiments run in this boot*/
+static covert_exp_t plan[COVERT_PLAN_MAX];
 
-/*init covert bench thread then letting them run*/
-void init_timing_threads(m_env_t *env) {
+/*physical address of the probe buffer of the LLC kernel spy, 0 if 
+ the spy allocates it, and the probe sets found in it*/
+static uintptr_t probe_buffer; 
+static bench_probe_sets_t probe_sets; 
 
-    uint32_t n_p = (sizeof (struct bench_l1) / BENCH_PAGE_SIZE) + 1;
 
-    /*over write according to the benchmark*/
-#ifdef CONFIG_BENCH_COVERT_LLC_KERNEL_SCHEDULE
-    n_p = (sizeof (struct bench_kernel_schedule) / BENCH_PAGE_SIZE) + 1;
-#endif 
-#ifdef CONFIG_BENCH_COVERT_TIMER 
-    n_p = (sizeof (struct bench_timer_online) / BENCH_PAGE_SIZE) + 1;
-#endif 
+/*number of recording pages, according to the benchmark*/
+static uint32_t record_pages(seL4_Word spy_num) {
 
-#ifdef CONFIG_BENCH_COVERT_LLC_KERNEL 
-    n_p = (sizeof (bench_llc_kernel_probe_result_t) / BENCH_PAGE_SIZE) + 1;
+    switch (spy_num) {
+    case BENCH_COVERT_LLC_KD_SPY:
+        return (sizeof (struct bench_kernel_schedule) / BENCH_PAGE_SIZE) + 1;
+    case BENCH_COVERT_TIMER_LOW:
+        return (sizeof (struct bench_timer_online) / BENCH_PAGE_SIZE) + 1;
+    case BENCH_COVERT_LLC_KERNEL_SPY:
+        return (sizeof (bench_llc_kernel_probe_result_t) / BENCH_PAGE_SIZE) + 1;
+    default:
+        return (sizeof (struct bench_l1) / BENCH_PAGE_SIZE) + 1;
+    }
+}
+
+/*does the spy stream its records, rather than leaving them 
+ in the recording frames until it finishes*/
+static bool streamed(seL4_Word spy_num) {
+
+#ifdef CONFIG_MANAGER_RECORD_RING
+    /*the spies recording a struct bench_l1*/
+    switch (spy_num) {
+    case BENCH_COVERT_LLC_KD_SPY:
+    case BENCH_COVERT_TIMER_LOW:
+    case BENCH_COVERT_LLC_KERNEL_SPY:
+    case BENCH_MASTIK_SPY:
+        return false; 
+    default:
+        return true; 
+    }
+#else 
+    return false; 
 #endif 
+}
+
+/*parse the probe sets printed by an earlier boot: the physical address 
+ of the probe buffer, then api@offset=page/page/... entries seperated by 
+ spaces. sets found in a buffer elsewhere are dropped*/
+static int parse_probe_sets(const char *s, bench_probe_sets_t *sets) {
+
+    char *end; 
+
+    sets->n = 0; 
+    if (!strcmp(s, "none"))
+        return BENCH_SUCCESS; 
+
+    if (strtoul(s, &end, 0) != probe_buffer || end == s) {
+        printf("probe sets: from another probe buffer, dropped\n");
+        return BENCH_SUCCESS; 
+    }
+    s = end; 
+
+    while (*s) {
+        bench_probe_set_t *set = sets->set + sets->n; 
+        const char *entry; 
+        unsigned long v; 
+
+        while (*s == ' ')
+            s++;
+        if (!*s)
+            break; 
+
+        if (sets->n == BENCH_PROBE_SETS_MAX) {
+            printf("probe sets: more than %d sets\n", BENCH_PROBE_SETS_MAX);
+            return BENCH_FAILURE;
+        }
+
+        entry = s; 
+        v = strtoul(s, &end, 0); 
+        if (end == s || *end != '@' || v >= timing_api_num)
+            goto bad; 
+        set->api = v; 
+        s = end + 1; 
+
+        v = strtoul(s, &end, 0); 
+        if (end == s || *end != '=' || v >= BENCH_PAGE_SIZE || v % 64)
+            goto bad; 
+        set->offset = v; 
+        s = end; 
+
+        for (set->lines = 0; *s == '=' || *s == '/'; set->lines++) {
+            s++;
+            v = strtoul(s, &end, 0); 
+            if (end == s || set->lines == BENCH_PROBE_SET_LINES || 
+                    v >= BENCH_PROBE_BUFFER_SIZE / BENCH_PAGE_SIZE)
+                goto bad; 
+            set->page[set->lines] = v; 
+            s = end; 
+        }
+        if (*s && *s != ' ')
+            goto bad; 
+        sets->n++;
+        continue; 
+bad:
+        printf("probe sets: bad entry at \"%s\"\n", entry);
+        return BENCH_FAILURE;
+    }
+
+    return BENCH_SUCCESS; 
+}
+
+/*print the probe sets in the form parse_probe_sets() takes, 
+ for CONFIG_MANAGER_PROBE_SETS of a later boot*/
+static void print_probe_sets(bench_probe_sets_t *sets) {
+
+    printf("probe sets: %#lx", (unsigned long)probe_buffer);
 
+    for (int i = 0; i < sets->n; i++) {
+        bench_probe_set_t *set = sets->set + i; 
+
+        printf(" %u@%#x", set->api, set->offset);
+        for (int l = 0; l < set->lines; l++) 
+            printf("%c%u", l ? '/' : '=', set->page[l]);
+    }
+    printf("\n");
+}
+
+/*init covert bench thread then letting them run*/
+void init_timing_threads(m_env_t *env, covert_exp_t *exp) {
+
+    uint32_t n_p = record_pages(exp->spy);
     uintptr_t share_phy; 
     int error; 
 
@@ -70,6 +198,16 @@ void init_timing_threads(m_env_t *env) {
     printf("creating recording frames for spy\n"); 
     map_r_buf(env, n_p, &spy);
 
+    if (exp->spy == BENCH_COVERT_LLC_KERNEL_SPY && probe_buffer) {
+        bench_llc_kernel_probe_result_t *r = env->record_vaddr; 
+
+        printf("creating probe buffer for spy at %#lx\n", 
+                (unsigned long)probe_buffer); 
+        map_probe_buf(&spy, probe_buffer, BENCH_PROBE_BUFFER_SIZE);
+        /*the sets found before, for the spy to verify*/
+        r->saved = probe_sets; 
+    }
+
 #ifdef CONFIG_ARCH_ARM 
     /*assign a priority number to all the IRQ associated with 
      the timer*/
@@ -128,10 +266,50 @@ void init_timing_threads(m_env_t *env) {
 }
 
 
-int run_single_l1(m_env_t *env) {
+#ifdef CONFIG_MANAGER_RECORD_RING
+/*export the records of the spy as they are published, returning the 
+ number lost by being overwritten before they were read*/
+static uint32_t drain_l1(struct bench_l1 *r_d, uint32_t points, export_t *e) {
+
+    uint32_t tail = 0, head, lost = 0; 
+
+    while (tail < points) {
+
+        head = __atomic_load_n(&r_d->head, __ATOMIC_ACQUIRE);
+
+        /*the spy has lapped us*/
+        if (head - tail > BENCH_RING_SLOTS) {
+            lost += head - BENCH_RING_SLOTS - tail; 
+            tail = head - BENCH_RING_SLOTS; 
+        }
+
+        for (; tail < head; tail++) {
+            uint32_t sec = r_d->sec[BENCH_RECORD_SLOT(tail)];
+            uint32_t result = r_d->result[BENCH_RECORD_SLOT(tail)];
+
+            /*the spy writes record head before publishing it, so the 
+             slot is reused once head reaches tail + BENCH_RING_SLOTS*/
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (r_d->head - tail >= BENCH_RING_SLOTS) {
+                lost++; 
+                continue; 
+            }
+            if (tail >= BENCH_TIMING_WARMUPS)
+                export_point(e, sec, result);
+        }
+    }
+    return lost; 
+}
+#endif 
+
+int run_single_l1(m_env_t *env, int points) {
     
     seL4_MessageInfo_t info;
     struct bench_l1 *r_d;
+    export_t e;
+#ifdef CONFIG_MANAGER_RECORD_RING
+    uint32_t lost; 
+#endif 
 
    
     info = seL4_Recv(t_ep.cptr, NULL);
@@ -139,35 +317,49 @@ int run_single_l1(m_env_t *env) {
        return BENCH_FAILURE;
     printf("trojan is ready\n");
     
+#ifdef CONFIG_MANAGER_RECORD_RING
+    r_d =  (struct bench_l1 *)env->record_vaddr;
+    export_start(&e, "probing time start", "probing time end");
+    lost = drain_l1(r_d, points, &e);
+    export_end(&e);
+    if (lost)
+        printf("ring overrun, %u data points lost\n", lost);
+#endif 
+
     info = seL4_Recv(s_ep.cptr, NULL);
     if (seL4_MessageInfo_get_label(info) != seL4_Fault_NullFault)
         return BENCH_FAILURE;
     printf("benchmark result ready\n");
 
+#ifndef CONFIG_MANAGER_RECORD_RING
 #ifdef CONFIG_FLUSH_CORE_STATES 
     /*trun off the flag for cache flush, making the printing faster*/
     seL4_Yield();
 #endif
 
     r_d =  (struct bench_l1 *)env->record_vaddr;
-    printf("probing time start\n");
+    export_start(&e, "probing time start", "probing time end");
     
-    for (int i = BENCH_TIMING_WARMUPS; i < CONFIG_BENCH_DATA_POINTS; i++) {
-        printf("%d %u\n", r_d->sec[i], r_d->result[i]);
+    for (int i = BENCH_TIMING_WARMUPS; i < points; i++) {
+        export_point(&e, r_d->sec[i], r_d->result[i]);
 
     }
-    printf("probing time end\n");
+    export_end(&e);
+#endif 
 
 #ifdef CONFIG_MANAGER_PMU_COUNTER 
     printf("enabled %d pmu counters\n", BENCH_PMU_COUNTERS);
     for (int counter = 0; counter < BENCH_PMU_COUNTERS; counter++) {
+        char start[32], end[32];
 
         /*print out the pmu counter one by one */
-        printf("pmu counter %d start\n",  counter); 
-        for (int i = BENCH_TIMING_WARMUPS; i < CONFIG_BENCH_DATA_POINTS; i++) {
-            printf("%d %u\n", r_d->sec[i], r_d->pmu[i][counter]);
+        snprintf(start, sizeof start, "pmu counter %d start", counter);
+        snprintf(end, sizeof end, "pmu counter %d end", counter);
+        export_start(&e, start, end);
+        for (int i = BENCH_TIMING_WARMUPS; i < points; i++) {
+            export_point(&e, r_d->sec[i], r_d->pmu[i][counter]);
         }
-        printf("pmu counter %d end\n", counter);
+        export_end(&e);
     }
 #endif 
 
@@ -176,7 +368,7 @@ int run_single_l1(m_env_t *env) {
 }
 
 
-int run_covert_llc_kernel(m_env_t *env) {
+int run_covert_llc_kernel(m_env_t *env, int points) {
 
     bench_llc_kernel_probe_result_t *probe_result = NULL; 
 
@@ -185,6 +377,7 @@ int run_covert_llc_kernel(m_env_t *env) {
     seL4_MessageInfo_t tag;
     uint32_t lines = 0; 
     enum timing_api seq; 
+    export_t e;
 
     info = seL4_Recv(s_ep.cptr, NULL);
     if (seL4_MessageInfo_get_label(info) != seL4_Fault_NullFault)
@@ -219,14 +412,20 @@ int run_covert_llc_kernel(m_env_t *env) {
     printf("Spy: probe sets for tcb  %d\n", probe_result->probe_sets[timing_tcb]);
     printf("Spy: probe sets for poll %d\n", probe_result->probe_sets[timing_poll]);
 
+    if (probe_buffer) {
+        printf("Spy: probe sets verified %d of %d\n", 
+                probe_result->saved.verified, probe_sets.n);
+        /*carried to the next experiment, and printed for the next boot*/
+        probe_sets = probe_result->saved; 
+        print_probe_sets(&probe_sets);
+    }
 
-    printf("probing time start\n");
 
-    for (int i = BENCH_TIMING_WARMUPS; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    export_start(&e, "probing time start", "Probing end");
 
-        seq = probe_result->probe_seq[i]; 
+    for (int i = BENCH_TIMING_WARMUPS; i < points; i++) {
 
-        printf("%d", seq); 
+        seq = probe_result->probe_seq[i]; 
 
         for (int j = 0; j < timing_api_num; j++) {
             //    printf(" %d", probe_result->probe_results[i][j]);
@@ -234,21 +433,22 @@ int run_covert_llc_kernel(m_env_t *env) {
             lines += probe_result->probe_results[i][j]; 
         }
 
-        printf(" %d\n", lines);
+        export_point(&e, seq, lines);
 
         lines = 0; 
     }
-    printf("Probing end\n");
+    export_end(&e);
 
     printf("done covert benchmark\n");
     return BENCH_SUCCESS; 
 }
 
 
-int run_single_llc_kernel_schedule(m_env_t *env) {
+int run_single_llc_kernel_schedule(m_env_t *env, int points) {
 
     seL4_MessageInfo_t info;
     struct bench_kernel_schedule *r_d;
+    export_t e;
 
     printf("starting covert channel benchmark, LLC, kernel deterministic schedueling\n");
 
@@ -263,32 +463,33 @@ int run_single_llc_kernel_schedule(m_env_t *env) {
     printf("benchmark result ready\n");
 
     r_d =  (struct bench_kernel_schedule *)env->record_vaddr;
-    printf("online time start\n");
+    export_start(&e, "online time start", "online time end");
 
-    for (int i = BENCH_TIMING_WARMUPS; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for (int i = BENCH_TIMING_WARMUPS; i < points; i++) {
 
-        printf("%d "CCNT_FORMAT"\n", 
-                r_d->prev_sec[i], r_d->prevs[i] - r_d->starts[i]);
+        export_point(&e, r_d->prev_sec[i], 
+                (ccnt_t)(r_d->prevs[i] - r_d->starts[i]));
 
     }
-    printf("online time end\n");
+    export_end(&e);
 
-    printf("offline time start\n");
-    for (int i = BENCH_TIMING_WARMUPS; i < CONFIG_BENCH_DATA_POINTS; i++) {
-        printf("%d "CCNT_FORMAT"\n", 
-                r_d->cur_sec[i], r_d->curs[i] - r_d->prevs[i]);
+    export_start(&e, "offline time start", "offline time end");
+    for (int i = BENCH_TIMING_WARMUPS; i < points; i++) {
+        export_point(&e, r_d->cur_sec[i], 
+                (ccnt_t)(r_d->curs[i] - r_d->prevs[i]));
     }
-    printf("offline time end\n");
+    export_end(&e);
 
     printf("done covert benchmark\n");
     return BENCH_SUCCESS;
 }
 
 
-int run_single_timer(m_env_t *env) {
+int run_single_timer(m_env_t *env, int points) {
 
     seL4_MessageInfo_t info;
     struct bench_timer_online *r_d = (struct bench_timer_online *)env->record_vaddr;
+    export_t e;
     info = seL4_Recv(t_ep.cptr, NULL);
     if (seL4_MessageInfo_get_label(info) != seL4_Fault_NullFault)
        return BENCH_FAILURE;
@@ -298,14 +499,14 @@ int run_single_timer(m_env_t *env) {
     if (seL4_MessageInfo_get_label(info) != seL4_Fault_NullFault)
         return BENCH_FAILURE;
     printf("benchmark result ready\n");
-    printf("probing time start\n");
+    export_start(&e, "probing time start", "probing time end");
  
-    for (int i = BENCH_TIMING_WARMUPS; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for (int i = BENCH_TIMING_WARMUPS; i < points; i++) {
 
-        printf("%d "CCNT_FORMAT"\n", r_d->sec[i],
-                r_d->prevs[i] - r_d->starts[i]);
+        export_point(&e, r_d->sec[i],
+                (ccnt_t)(r_d->prevs[i] - r_d->starts[i]));
     }
-    printf("probing time end\n");
+    export_end(&e);
 
 
     printf("done covert benchmark\n");
@@ -347,57 +548,75 @@ int run_multi(m_env_t *env) {
 
 
 /*running the single core attack*/ 
-int run_timing_threads(m_env_t *env) {
+int run_timing_threads(m_env_t *env, covert_exp_t *exp) {
 
     printf("starting covert channel benchmark\n");
 
-    printf("data points %d with random sequence\n", CONFIG_BENCH_DATA_POINTS);
+    printf("data points %d with random sequence\n", exp->points);
+
+    switch (exp->spy) {
+    case BENCH_COVERT_LLC_KERNEL_SPY:
+        return run_covert_llc_kernel(env, exp->points); 
+    case BENCH_COVERT_LLC_KD_SPY:
+        return run_single_llc_kernel_schedule(env, exp->points); 
+    case BENCH_COVERT_TIMER_LOW:
+        return run_single_timer(env, exp->points); 
+    case BENCH_MASTIK_SPY:
+        return run_multi(env); 
+    default:
+        return run_single_l1(env, exp->points); 
+    }
+}
 
-#ifdef CONFIG_BENCH_COVERT_LLC_KERNEL
-    return run_covert_llc_kernel(env); 
-#endif 
+/*destroy the trojan and spy with the objects created for them, 
+ so that the next experiment starts from the same state*/
+static void destroy_timing_threads(m_env_t *env, covert_exp_t *exp) {
 
-#ifdef CONFIG_BENCH_COVERT_LLC_KERNEL_SCHEDULE
-    return run_single_llc_kernel_schedule(env); 
-#endif 
+    /*the recording frames mapped to the root task*/
+    vspace_unmap_pages(&env->vspace, env->record_vaddr, 
+            record_pages(exp->spy), PAGE_BITS_4K, VSPACE_FREE);
+    env->record_vaddr = NULL; 
 
-#ifdef CONFIG_BENCH_COVERT_TIMER 
-    return run_single_timer(env); 
-#endif
+    /*spy first, the shared frames are owned by trojan*/
+    destroy_thread(&spy); 
+    destroy_thread(&trojan); 
 
-#ifdef CONFIG_MASTIK_ATTACK_SIDE 
-    return run_multi(env); 
-#endif 
+    vka_free_object(spy.vka, &spy.fake_tcb); 
+    vka_free_object(trojan.vka, &trojan.fake_tcb); 
+    vka_free_object(spy.vka, &spy.notification_ep); 
+    vka_free_object(trojan.vka, &trojan.notification_ep); 
 
-    return run_single_l1(env); 
+    vka_free_object(env->ipc_vka, &t_ep); 
+    vka_free_object(env->ipc_vka, &s_ep); 
+    vka_free_object(env->ipc_vka, &syn_ep); 
 }
 
-
-/*entry point of covert channel benchmark*/
-void launch_bench_covert (m_env_t *env) {
+/*set up a trojan and spy pair for the experiment*/
+static void setup_timing_threads(m_env_t *env, covert_exp_t *exp) {
 
     int ret; 
     trojan.image = spy.image = CONFIG_BENCH_THREAD_NAME;
     trojan.vspace = spy.vspace = &env->vspace;
     trojan.name = "trojan"; 
     spy.name = "spy";
-#ifdef CONFIG_MANAGER_MITIGATION 
-    /*using sperate kernels*/
-    trojan.kernel = env->kimages[0].ki.cptr; 
-    spy.kernel = env->kimages[1].ki.cptr;
-#else 
-    /*by default the kernel is shared*/
-    trojan.kernel = spy.kernel = env->kernel;
-#endif  
-
-#if defined (CONFIG_MANAGER_MITIGATION) || defined (CONFIG_BENCH_COVERT_LLC_KERNEL)
-    trojan.vka = &env->vka_colour[0]; 
-    spy.vka = &env->vka_colour[1]; 
-    env->ipc_vka = &env->vka_colour[0];
-#else 
-    spy.vka = trojan.vka = &env->vka; 
-    env->ipc_vka = &env->vka;
-#endif
+
+    if (exp->mitigation) {
+        /*using sperate kernels*/
+        trojan.kernel = env->kimages[0].ki.cptr; 
+        spy.kernel = env->kimages[1].ki.cptr;
+    } else {
+        /*by default the kernel is shared*/
+        trojan.kernel = spy.kernel = env->kernel;
+    }
+
+    if (exp->mitigation || exp->spy == BENCH_COVERT_LLC_KERNEL_SPY) {
+        trojan.vka = &env->vka_colour[0]; 
+        spy.vka = &env->vka_colour[1]; 
+        env->ipc_vka = &env->vka_colour[0];
+    } else {
+        spy.vka = trojan.vka = &env->vka; 
+        env->ipc_vka = &env->vka;
+    }
 
 
     spy.root_vka = trojan.root_vka = &env->vka;
@@ -438,19 +657,253 @@ void launch_bench_covert (m_env_t *env) {
     trojan.prio = 100;
     spy.prio = 100; 
 
-    /*set the actual testing num in bench_common.h*/
-    spy.test_num = BENCH_COVERT_SPY;
-    trojan.test_num = BENCH_COVERT_TROJAN; 
+    spy.test_num = exp->spy;
+    trojan.test_num = exp->trojan; 
+    spy.data_points = trojan.data_points = exp->points; 
 
 #if CONFIG_MAX_NUM_NODES > 1
     spy.affinity  = 0;
     trojan.affinity = 1; 
 #endif 
 
-    init_timing_threads(env);
+    init_timing_threads(env, exp);
+}
+
+#ifdef MANAGER_DOMAIN_SWITCH_TRACE
+/*the domain switch costs in the kernel log, by trace point from
+ CONFIG_DOMAIN_SWITCH_TRACE_POINT: the latency from the start of the switch
+ to the time pad and to the end of it, and the cycles spent touching the
+ shared kernel data*/
+static void print_domain_switch(m_env_t *env) {
+
+    const char *names[3] = {"domain switch", "domain switch padded", 
+        "domain switch touch"}; 
+    kernel_log_entry_t *klogs = env->kernel_log_vaddr; 
+    seL4_Word min[3] = {~0UL, ~0UL, ~0UL}, max[3] = {0, 0, 0}; 
+    uint64_t sum[3] = {0, 0, 0}, n[3] = {0, 0, 0}; 
+    seL4_Word nlog = seL4_BenchmarkFinalizeLog(); 
+
+    if (nlog > KERNEL_MAX_NUM_LOG_ENTRIES) {
+        printf("domain switch: %lu log entries lost\n", 
+                (unsigned long)(nlog - KERNEL_MAX_NUM_LOG_ENTRIES)); 
+        nlog = KERNEL_MAX_NUM_LOG_ENTRIES; 
+    }
+
+    for (seL4_Word i = 0; i < nlog; i++) {
+        seL4_Word key = kernel_logging_entry_get_key(klogs + i) - 
+            CONFIG_DOMAIN_SWITCH_TRACE_POINT; 
+        seL4_Word d = kernel_logging_entry_get_data(klogs + i); 
+
+        /*other trace points wrap around to large keys*/
+        if (key > 2)
+            continue; 
+        if (d < min[key])
+            min[key] = d; 
+        if (d > max[key])
+            max[key] = d; 
+        sum[key] += d; 
+        n[key]++; 
+    }
+
+    for (int key = 0; key < 3; key++) {
+        if (!n[key])
+            continue; 
+        printf("%s: %llu switches, min %lu mean %llu max %lu\n", names[key], 
+                (unsigned long long)n[key], (unsigned long)min[key], 
+                (unsigned long long)(sum[key] / n[key]), (unsigned long)max[key]); 
+    }
+}
+#endif 
+
+/*the value of key in the bootargs of the boot device tree, as key=value or
+ key="value with spaces", or NULL. the boot loader sets the bootargs, so they
+ change without rebuilding the image*/
+static char *boot_arg(simple_t *simple, const char *key) {
+
+    ssize_t size = simple_get_extended_bootinfo_length(simple, 
+            SEL4_BOOTINFO_HEADER_FDT);
+    size_t klen = strlen(key); 
+    char *block, *ret = NULL; 
+    const char *s, *end; 
+    const void *fdt; 
+    int node, len; 
+
+    if (size <= (ssize_t)sizeof(seL4_BootInfoHeader))
+        return NULL; 
+
+    block = malloc(size); 
+    assert(block); 
+    if (simple_get_extended_bootinfo(simple, SEL4_BOOTINFO_HEADER_FDT, 
+                block, size) != size)
+        goto out; 
+
+    fdt = block + sizeof(seL4_BootInfoHeader); 
+    if (fdt_check_header(fdt))
+        goto out; 
+    node = fdt_path_offset(fdt, "/chosen"); 
+    if (node < 0)
+        goto out; 
+    s = fdt_getprop(fdt, node, "bootargs", &len); 
+    if (!s || len <= 0 || s[len - 1])
+        goto out; 
+
+    while (*s) {
+        while (*s == ' ')
+            s++;
+
+        if (!strncmp(s, key, klen) && s[klen] == '=') {
+            s += klen + 1; 
+            if (*s == '"') 
+                end = strchr(++s, '"'); 
+            else 
+                end = strchr(s, ' '); 
+            ret = end ? strndup(s, end - s) : strdup(s); 
+            assert(ret); 
+            break; 
+        }
+
+        /*skip to the next argument, over any quoted spaces*/
+        while (*s && *s != ' ') {
+            if (*s == '"' && !(s = strchr(s + 1, '"')))
+                goto out; 
+            s++;
+        }
+    }
+
+out:
+    free(block); 
+    return ret; 
+}
+
+/*parse the test plan: entries of "trojan,spy[,points[,mitigation]]"
+ seperated by spaces, returning the number of experiments*/
+static int parse_plan(const char *s, covert_exp_t *exps) {
+
+    int n = 0; 
+
+    while (*s) {
+        covert_exp_t *exp = exps + n; 
+        const char *entry; 
+        char *end; 
+        long v[4] = {0, 0, CONFIG_BENCH_DATA_POINTS, 0};
+        int f = 0; 
+
+        while (*s == ' ')
+            s++;
+        if (!*s)
+            break; 
+
+        if (n == COVERT_PLAN_MAX) {
+            printf("covert plan: more than %d experiments\n", COVERT_PLAN_MAX);
+            return BENCH_FAILURE;
+        }
+
+        entry = s; 
+        while (f < 4) {
+            v[f++] = strtol(s, &end, 0); 
+            if (end == s)
+                goto bad; 
+            s = end; 
+            if (*s != ',')
+                break; 
+            s++;
+        }
+        if (f < 2 || (*s && *s != ' '))
+            goto bad; 
+
+        exp->trojan = v[0];
+        exp->spy = v[1];
+        exp->points = v[2];
+        exp->mitigation = v[3];
+
+        if (exp->trojan >= BENCH_COVERT_FUNS || exp->spy >= BENCH_COVERT_FUNS)
+            goto bad; 
+        if (v[2] <= BENCH_TIMING_WARMUPS || v[2] > INT_MAX)
+            goto bad; 
+        /*the recording frames are sized for CONFIG_BENCH_DATA_POINTS, 
+         unless the records are streamed through the ring*/
+        if (exp->points > CONFIG_BENCH_DATA_POINTS && !streamed(exp->spy))
+            goto bad; 
+#if !defined (CONFIG_MULTI_KERNEL_IMAGES) || !defined (CONFIG_LIB_SEL4_CACHECOLOURING)
+        /*no kernel images or colours to seperate the domains*/
+        if (exp->mitigation)
+            goto bad; 
+#endif 
+        n++;
+        continue; 
+bad:
+        printf("covert plan: bad entry at \"%s\"\n", entry);
+        return BENCH_FAILURE;
+    }
+
+    return n; 
+}
+
+/*entry point of covert channel benchmark*/
+void launch_bench_covert (m_env_t *env) {
+
+    /*covert_plan= and probe_sets= in the boot arguments override the 
+     configured plan and probe sets*/
+    char *plan_arg = boot_arg(&env->simple, "covert_plan"); 
+    char *sets_arg = boot_arg(&env->simple, "probe_sets"); 
+    const char *plan_s = plan_arg ? plan_arg : CONFIG_MANAGER_COVERT_PLAN; 
+    int ret, n; 
+
+    if (plan_arg)
+        printf("covert plan: from the boot arguments\n");
+
+    if (strcmp(CONFIG_MANAGER_PROBE_BUFFER, "none")) {
+        probe_buffer = strtoul(CONFIG_MANAGER_PROBE_BUFFER, NULL, 0); 
+        assert(probe_buffer && !(probe_buffer % BENCH_PAGE_SIZE)); 
+        if (sets_arg)
+            printf("probe sets: from the boot arguments\n");
+        ret = parse_probe_sets(sets_arg ? sets_arg : CONFIG_MANAGER_PROBE_SETS, 
+                &probe_sets); 
+        assert(ret == BENCH_SUCCESS); 
+    }
+    free(sets_arg); 
+
+    if (!strcmp(plan_s, "none")) {
+        /*set the actual testing num in bench_common.h*/
+        plan[0].trojan = BENCH_COVERT_TROJAN; 
+        plan[0].spy = BENCH_COVERT_SPY;
+        plan[0].points = CONFIG_BENCH_DATA_POINTS;
+#ifdef CONFIG_MANAGER_MITIGATION 
+        plan[0].mitigation = true; 
+#endif 
+        n = 1; 
+    } else {
+        n = parse_plan(plan_s, plan); 
+        assert(n > 0); 
+        printf("covert plan: %d experiments\n", n);
+    }
+    free(plan_arg); 
+
+    for (int i = 0; i < n; i++) {
+
+        /*tag the output of each experiment in the plan*/
+        if (n > 1) 
+            printf("covert experiment %d: trojan %zu spy %zu points %d mitigation %d\n", 
+                    i, (size_t)plan[i].trojan, (size_t)plan[i].spy, 
+                    plan[i].points, plan[i].mitigation);
 
-    ret = run_timing_threads(env);
-    assert(ret == BENCH_SUCCESS);
+        setup_timing_threads(env, plan + i);
 
+#ifdef MANAGER_DOMAIN_SWITCH_TRACE
+        seL4_BenchmarkResetLog(); 
+#endif
+        ret = run_timing_threads(env, plan + i);
+        assert(ret == BENCH_SUCCESS);
+#ifdef MANAGER_DOMAIN_SWITCH_TRACE
+        print_domain_switch(env); 
+#endif
+
+        if (n > 1) 
+            printf("covert experiment %d done\n", i);
+
+        /*the last pair is left as it was*/
+        if (i < n - 1)
+            destroy_timing_threads(env, plan + i);
+    }
 }
 #endif  /*CONFIG_MANAGER_COVERT_BENCH*/
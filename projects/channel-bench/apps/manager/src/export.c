@@ -0,0 +1,115 @@
+/*
+ * Copyright 2017, Data61
+ * Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+ * ABN 41 687 119 230.
+ *
+ * This software may be distributed and modified according to the terms of
+ * the BSD 2-Clause license. Note that NO WARRANTY is provided.
+ * See "LICENSE_BSD2.txt" for details.
+ *
+ * @TAG(DATA61_BSD)
+ */
+/*This file contains functions for exporting benchmark data points.
+
+  By default, each data point is printed as an "<input> <output>" line
+  between the start and end lines of its section.
+
+  With CONFIG_MANAGER_BINARY_EXPORT, a section is instead streamed as base64
+  encoded CBOR, between "cbor64 start" and "cbor64 end" lines. The item is an
+  array of three: the start line, the end line (both UTF-8), and the data
+  points as a chunked byte string. Each data point is two LEB128 varints:
+  the zigzag encoded input, then the zigzag encoded difference between the
+  output and the previous output in the section (starting from 0).
+  tools/channel-bench/decode_export turns the log back into exactly the text
+  that would have been printed.*/
+
+#include <autoconf.h>
+#include <manager/gen_config.h>
+#include <stdio.h>
+#include "export.h"
+
+#ifdef CONFIG_MANAGER_BINARY_EXPORT
+#include <utils/cbor64.h>
+
+/*zigzag: small magnitudes of either sign encode in few bytes*/
+static inline uint64_t zigzag(int64_t v) {
+
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static void export_varint(export_t *e, uint64_t v) {
+
+    while (v >= 0x80) {
+        e->chunk[e->fill++] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    e->chunk[e->fill++] = v;
+}
+
+/*send the buffered chunk, then break the line so that the log stays
+ readable by line-based tools*/
+static void export_flush(export_t *e) {
+
+    if (e->fill) {
+        cbor64_bytes(&e->streamer, e->chunk, e->fill);
+        e->fill = 0;
+        putchar('\n');
+    }
+}
+
+void export_start(export_t *e, char *start, char *end) {
+
+    printf("cbor64 start\n");
+
+    e->streamer = base64_new(stdout);
+    e->prev = 0;
+    e->fill = 0;
+
+    cbor64_array_length(&e->streamer, 3);
+    cbor64_utf8(&e->streamer, start);
+    cbor64_utf8(&e->streamer, end);
+    /*cbor64_byte_chunks_start() encodes the indefinite length as a
+     definite length of 31, so build the initial byte directly*/
+    cbor64_initial_byte(&e->streamer, CBOR64_MT_BYTE_STRING,
+            CBOR64_AI_INDEFINITE_LENGTH);
+}
+
+void export_point(export_t *e, int input, uint64_t output) {
+
+    /*two varints of at most 10 bytes each*/
+    if (e->fill + 20 > EXPORT_CHUNK)
+        export_flush(e);
+
+    export_varint(e, zigzag(input));
+    export_varint(e, zigzag((int64_t)(output - e->prev)));
+    e->prev = output;
+}
+
+void export_end(export_t *e) {
+
+    export_flush(e);
+    cbor64_byte_chunks_end(&e->streamer);
+    base64_terminate(&e->streamer);
+
+    printf("\ncbor64 end\n");
+}
+
+#else
+
+void export_start(export_t *e, char *start, char *end) {
+
+    e->end = end;
+    printf("%s\n", start);
+}
+
+void export_point(export_t *e, int input, uint64_t output) {
+
+    printf("%d %llu\n", input, (unsigned long long)output);
+}
+
+void export_end(export_t *e) {
+
+    printf("%s\n", e->end);
+}
+
+#endif /*CONFIG_MANAGER_BINARY_EXPORT*/
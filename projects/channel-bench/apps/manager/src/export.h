@@ -0,0 +1,50 @@
+/*
+ * Copyright 2017, Data61
+ * Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+ * ABN 41 687 119 230.
+ *
+ * This software may be distributed and modified according to the terms of
+ * the BSD 2-Clause license. Note that NO WARRANTY is provided.
+ * See "LICENSE_BSD2.txt" for details.
+ *
+ * @TAG(DATA61_BSD)
+ */
+
+/*interface in export.c, kept free of seL4 headers so that
+ tools/channel-bench can build export.c on the host and check it against
+ decode_export*/
+
+#ifndef __MANAGER_EXPORT_H
+#define __MANAGER_EXPORT_H
+
+#include <autoconf.h>
+#include <manager/gen_config.h>
+#include <stddef.h>
+#include <stdint.h>
+#ifdef CONFIG_MANAGER_BINARY_EXPORT
+#include <utils/base64.h>
+#endif
+
+/*bytes of data points sent per CBOR chunk*/
+#define EXPORT_CHUNK  192
+
+/*a section of data points being exported*/
+typedef struct {
+#ifdef CONFIG_MANAGER_BINARY_EXPORT
+    base64_t streamer;
+    uint64_t prev;            /*last output, points are delta encoded*/
+    size_t fill;
+    unsigned char chunk[EXPORT_CHUNK];
+#else
+    char *end;
+#endif
+} export_t;
+
+/*start a section, framed by the given lines*/
+void export_start(export_t *e, char *start, char *end);
+/*export a data point, printed as "<input> <output>"*/
+void export_point(export_t *e, int input, uint64_t output);
+/*finish the section*/
+void export_end(export_t *e);
+
+#endif /*__MANAGER_EXPORT_H*/
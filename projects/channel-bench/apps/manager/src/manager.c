@@ -16,6 +16,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h> 
+#include <stddef.h>
 
 #include <allocman/bootstrap.h>
 #include <allocman/vka.h> 
@@ -318,12 +319,86 @@ static void init_pmu_counters(void) {
 #endif
 
 
+bench_geometry_t bench_geometry; 
+
+/*parse the description of the cache geometry, space separated entries: 
+ l1d, l2 and l3=associativity/sets/line, tlb=entries/probe pages, btac=entries*/
+static int parse_geometry(const char *s, bench_geometry_t *g) {
+
+    static const struct {
+        const char *name; 
+        int fields; 
+        size_t offset; 
+    } keys[] = {
+        {"l1d", 3, offsetof(bench_geometry_t, l1d)},
+        {"l2", 3, offsetof(bench_geometry_t, l2)},
+        {"l3", 3, offsetof(bench_geometry_t, l3)},
+        {"tlb", 2, offsetof(bench_geometry_t, tlb_entries)},
+        {"btac", 1, offsetof(bench_geometry_t, btac_entries)},
+    };
+
+    memset(g, 0, sizeof (bench_geometry_t));
+
+    if (!strcmp(s, "none"))
+        return BENCH_SUCCESS; 
+
+    while (*s) {
+        const char *entry; 
+        uint32_t *v = NULL; 
+        int fields = 0; 
+        size_t len; 
+
+        while (*s == ' ')
+            s++;
+        if (!*s)
+            break; 
+
+        entry = s; 
+        len = strcspn(s, "="); 
+        for (int k = 0; k < ARRAY_SIZE(keys); k++) {
+            if (strlen(keys[k].name) == len && !strncmp(s, keys[k].name, len)) {
+                v = (uint32_t *)((char *)g + keys[k].offset);
+                fields = keys[k].fields; 
+            }
+        }
+        if (!v || s[len] != '=')
+            goto bad; 
+        s += len + 1; 
+
+        for (int f = 0; f < fields; f++) {
+            char *end; 
+            unsigned long n = strtoul(s, &end, 0); 
+
+            if (end == s || !n || n > UINT32_MAX)
+                goto bad; 
+            v[f] = n; 
+            s = end; 
+            if (f < fields - 1) {
+                if (*s != '/')
+                    goto bad; 
+                s++;
+            }
+        }
+        if (*s && *s != ' ')
+            goto bad; 
+        continue; 
+bad:
+        printf("cache geometry: bad entry at \"%s\"\n", entry);
+        return BENCH_FAILURE;
+    }
+
+    return BENCH_SUCCESS; 
+}
+
 static void *main_continued (void* arg) {
     
     int error = 0; 
 
     printf("Done\n"); 
 
+    error = parse_geometry(CONFIG_MANAGER_CACHE_GEOMETRY, &bench_geometry);
+    assert(error == BENCH_SUCCESS); 
+
     /*understanding the timer, creating a IRQ cap*/
     error = sel4platsupport_init_default_timer_caps(&env.vka, &env.vspace, &env.simple, &env.to);
     assert(error == 0); 
@@ -448,7 +523,7 @@ int main (void) {
     err = platsupport_serial_setup_simple(&env.vspace, &env.simple, &env.vka); 
     assert(err == 0);
 
-#ifdef CONFIG_BENCHMARK_USE_KERNEL_LOG_BUFFER
+#if defined (CONFIG_BENCHMARK_USE_KERNEL_LOG_BUFFER) || defined (MANAGER_DOMAIN_SWITCH_TRACE)
     
     seL4_CPtr kernel_log_cap; 
     /*init the kernel log buffer, only read at user side*/
@@ -32,8 +32,20 @@
 #include <channel-bench/bench_helper.h>
 #include <sel4/types.h>
 
+#include "export.h"
+
 #define MANAGER_MORECORE_SIZE  (16 * 1024 * 1024)
 
+/*the kernel logs the latency of padded domain switches, and the cost
+ of touching the shared kernel data on them, from trace point
+ CONFIG_DOMAIN_SWITCH_TRACE_POINT up*/
+#if defined (CONFIG_DOMAIN_MICROARCH_FLUSH) && CONFIG_MAX_NUM_TRACE_POINTS > 0 && \
+    ((defined (CONFIG_DOMAIN_SWITCH_PAD) && \
+      CONFIG_MAX_NUM_TRACE_POINTS > CONFIG_DOMAIN_SWITCH_TRACE_POINT + 1) || \
+     CONFIG_MAX_NUM_TRACE_POINTS > CONFIG_DOMAIN_SWITCH_TRACE_POINT + 2)
+#define MANAGER_DOMAIN_SWITCH_TRACE
+#endif
+
 #define MAN_KIMAGES   CC_NUM_DOMAINS
 
 /*the kernel image used for benchmarking*/
@@ -100,6 +112,7 @@ typedef struct bench_thread {
     seL4_Word prio;         /*priority of benchmarking thread*/
     sel4utils_process_t process;  /*internal process context*/ 
     seL4_Word test_num;      /*test number*/
+    int data_points;         /*0 for CONFIG_BENCH_DATA_POINTS*/
  
     /*the affinity of this thread*/ 
     seL4_Word affinity;
@@ -231,6 +244,9 @@ static int copy_untyped(sel4utils_process_t *process, vka_t *vka,
 }
 
 
+/*cache geometry described to the benchmarking threads, in manager.c*/
+extern bench_geometry_t bench_geometry;
+
 static void create_thread(bench_thread_t *t, seL4_Domain d) {
 
     sel4utils_process_t *process = &t->process; 
@@ -249,10 +265,14 @@ static void create_thread(bench_thread_t *t, seL4_Domain d) {
     
     /*test number*/
     bench_args->test_num = t->test_num; 
+    bench_args->data_points = t->data_points ? t->data_points :
+        CONFIG_BENCH_DATA_POINTS;
 
     /*untype flag*/
     bench_args->untype_none = t->untype_none; 
 
+    bench_args->geometry = bench_geometry; 
+
     assert(t->simple);
 
     config = process_config_default_simple(t->simple, t->image, t->prio);
@@ -328,6 +348,21 @@ static void launch_thread(bench_thread_t *t) {
     assert(error == 0);
 }
 
+static void destroy_thread(bench_thread_t *t) {
+
+    /*undo create_thread and launch_thread, frames shared with
+     the root task must be unmapped from it beforehand*/
+    sel4utils_destroy_process(&t->process, t->vka);
+
+    if (!t->bench_args->untype_none) {
+        for (int i = 0; i < CONFIG_BENCH_UNTYPE_COUNT; i++)
+            vka_free_object(t->vka, t->bench_untypes + i);
+    }
+
+    vspace_unmap_pages(t->vspace, t->bench_args, 1, seL4_PageBits, VSPACE_FREE);
+    t->bench_args = NULL;
+}
+
 
 /*software polling for number of CPU ticks*/
 static void sw_sleep(unsigned int millsec) {
@@ -381,8 +416,42 @@ static void map_morecore_buf(size_t size, bench_thread_t *t) {
     args->morecore_size = size; 
     args->morecore_vaddr = (uintptr_t)vspace_new_pages(&p->vspace, seL4_AllRights, 
             n_p, PAGE_BITS_4K);
-    assert(args->morecore_vaddr); 
-    
+    assert(args->morecore_vaddr);
+
+}
+
+/*map the frames from paddr upwards as the probe buffer, so that the
+ buffer, and the probe sets found in it, are the same on every boot.
+ frames the thread's allocator cannot give (other colours) are skipped*/
+static void map_probe_buf(bench_thread_t *t, uintptr_t paddr, size_t size) {
+
+    static seL4_CPtr caps[BENCH_PROBE_BUFFER_SIZE >> PAGE_BITS_4K];
+    static uintptr_t cookies[BENCH_PROBE_BUFFER_SIZE >> PAGE_BITS_4K];
+    sel4utils_process_t *p = &t->process;
+    bench_args_t *args = t->bench_args;
+    size_t n_p = size >> PAGE_BITS_4K;
+#ifdef CONFIG_LIB_SEL4_CACHECOLOURING
+    uintptr_t limit = paddr + size * CONFIG_NUM_CACHE_COLOURS;
+#else
+    uintptr_t limit = paddr + size;
+#endif
+    vka_object_t frame;
+
+    assert(n_p <= ARRAY_SIZE(caps));
+
+    for (size_t i = 0; i < n_p; paddr += 1 << PAGE_BITS_4K) {
+        assert(paddr < limit);
+        if (vka_alloc_frame_at(t->vka, PAGE_BITS_4K, paddr, &frame))
+            continue;
+        caps[i] = frame.cptr;
+        cookies[i++] = frame.ut;
+    }
+
+    /*freed with the thread*/
+    args->probe_size = size;
+    args->probe_vaddr = (uintptr_t)vspace_map_pages(&p->vspace, caps, cookies,
+            seL4_AllRights, n_p, PAGE_BITS_4K, 1);
+    assert(args->probe_vaddr);
 }
 
 
@@ -167,13 +167,21 @@ int run_bench_covert(bench_env_t *bench_env) {
     seL4_Word test_num = bench_env->args->test_num;
     unsigned int seed; 
 
-#ifdef CONFIG_ARCH_ARM 
-    SEL4BENCH_READ_CCNT(seed);  
-#elif defined CONFIG_ARCH_RISCV
-    seed = rdtime();
-#else 
-    seed = rdtscp();
-#endif 
+    seed = bench_timestamp();
+#ifdef CONFIG_DEBUG_BUILD
+    uint32_t overhead, resolution, timer_tick = 0;
+
+    /*rdtime traps on some cores, only read it when asked to*/
+#ifdef CONFIG_BENCH_TIMER_TICK_CALIBRATE
+    bench_timestamp_calibrate(&overhead, &resolution, &timer_tick);
+    printf("timestamp: overhead %u resolution %u cycles, timer tick %u cycles\n",
+            overhead, resolution, timer_tick);
+#else
+    bench_timestamp_calibrate(&overhead, &resolution, NULL);
+    printf("timestamp: overhead %u resolution %u cycles\n",
+            overhead, resolution);
+#endif
+#endif
     /*run bench*/
     assert(covert_bench_fun[test_num] != NULL); 
 
@@ -337,6 +345,9 @@ int main (int argc, char **argv) {
 
     bench_init_env(argc, argv, &setup_env); 
 
+    /*the cache geometry used by the probing code*/
+    geometry_init(setup_env.args); 
+
 #ifdef CONFIG_BENCH_IPC
     run_bench_ipc(&setup_env); 
 #endif 
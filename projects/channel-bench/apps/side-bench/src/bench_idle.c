@@ -22,7 +22,7 @@
 
 static void access_llc_buffer(void *buffer) {
 
-    for (int i = 0; i < L3_SIZE; i += L1_CACHELINE)
+    for (int i = 0; i < cache_size(&geometry.l3); i += geometry.l1d.line)
         low_access(buffer + i); 
 }
 
@@ -36,7 +36,7 @@ int bench_idle(bench_env_t *env) {
 
 #ifdef CONFIG_MANAGER_SPLASH_BENCH_SWITCH
 
-    char *buf = (char *)mmap(NULL, L3_SIZE + 4096 * 2, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
+    char *buf = (char *)mmap(NULL, cache_size(&geometry.l3) + 4096 * 2, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
     assert(buf); 
     /*page aligned the buffer*/
     uintptr_t buf_switch = (uintptr_t) buf; 
@@ -20,7 +20,7 @@
 
 static void access_llc_buffer(void *buffer) {
 
-    for (int i = 0; i < L3_SIZE; i += L1_CACHELINE)
+    for (int i = 0; i < cache_size(&geometry.l3); i += geometry.l1d.line)
         low_access(buffer + i); 
 }
 
@@ -32,7 +32,7 @@ int llc_cache_flush(bench_env_t *env) {
     ccnt_t overhead, start, end;
 
     bench_args_t *args = env->args; 
-    char *buf = (char *)mmap(NULL, L3_SIZE + 4096 * 2, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
+    char *buf = (char *)mmap(NULL, cache_size(&geometry.l3) + 4096 * 2, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
     assert(buf); 
     /*page aligned the buffer*/
     uintptr_t buf_switch = (uintptr_t) buf; 
@@ -87,7 +87,7 @@ int llc_cache_flush_only(bench_env_t *env) {
     ccnt_t overhead, start, end;
 
     bench_args_t *args = env->args; 
-    char *buf = (char *)mmap(NULL, L3_SIZE + 4096 * 2, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
+    char *buf = (char *)mmap(NULL, cache_size(&geometry.l3) + 4096 * 2, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
     assert(buf); 
     /*page aligned the buffer*/
     uintptr_t buf_switch = (uintptr_t) buf; 
@@ -201,7 +201,7 @@ int l1_cache_flush_only(bench_env_t *env) {
 #ifdef CONFIG_BENCH_CACHE_FLUSH_L1_CACHES_INSTRUCTION
     l1iinfo_t l1i_1 = l1i_prepare(monitored_mask);
 #else 
-    l1info_t l1_1 = l1_prepare(monitored_mask);
+    l1info_t l1_1 = l1_prepare(geometry_prime_level(args->test_num), monitored_mask);
 #endif 
     /*the record address*/
     struct bench_cache_flush *r_addr = (struct bench_cache_flush *)args->record_vaddr;
@@ -265,7 +265,7 @@ int l1_cache_flush(bench_env_t *env) {
 #ifdef CONFIG_BENCH_CACHE_FLUSH_L1_CACHES_INSTRUCTION
     l1iinfo_t l1i_1 = l1i_prepare(monitored_mask);
 #else 
-    l1info_t l1_1 = l1_prepare(monitored_mask);
+    l1info_t l1_1 = l1_prepare(geometry_prime_level(args->test_num), monitored_mask);
 #endif 
     /*the record address*/
     struct bench_cache_flush *r_addr = (struct bench_cache_flush *)args->record_vaddr;
@@ -4,6 +4,7 @@
 #include <sel4/sel4.h>
 
 #include "../mastik_common/low.h"
+#include "../mastik_common/channel.h"
 #include <channel-bench/bench_common.h>
 #include <channel-bench/bench_types.h>
 
@@ -27,7 +28,7 @@ int bp_trojan(bench_env_t *env) {
 
   seL4_Send(args->ep, info);
   
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+  for (int i = 0; i < env->args->data_points; i++) {
 
       secret = (random() / 2) & 1;
       /*update the secret read by low*/ 
@@ -49,39 +50,18 @@ int bp_trojan(bench_env_t *env) {
   return 0;
 }
 
-int bp_spy(bench_env_t *env) {
-  seL4_Word badge;
-  seL4_MessageInfo_t info;
-  bench_args_t *args = env->args; 
-
-
-  /*the record address*/
-  struct bench_l1 *r_addr = (struct bench_l1 *)args->record_vaddr; 
-  /*the shared address*/
-  volatile uint32_t *secret = (uint32_t*)args->shared_vaddr;
-
-  /*syn with trojan*/
-  info = seL4_Recv(args->ep, &badge);
-  assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
-
-
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
-
-      newTimeSlice();
-   
-      /*result is the total probing cost
-        secret is updated by trojan in the previous system tick*/
-      r_addr->result[i] = bp_probe(0); 
-      r_addr->sec[i] = *secret; 
+static uint32_t bp_probe_spy(void *state) {
 
-  }
+  return bp_probe(0); 
+}
 
-  /*send result to manager, spy is done*/
-  info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-  seL4_SetMR(0, 0);
-  seL4_Send(args->r_ep, info);
+/*the trojan keeps training the predictor for the whole time slice, 
+  so only the spy is run by the channel driver*/
+static const channel_t bp_channel = {
+  .probe = bp_probe_spy,
+};
 
-  while (1);
+int bp_spy(bench_env_t *env) {
 
-  return 0;
+  return channel_spy(env, &bp_channel);
 }
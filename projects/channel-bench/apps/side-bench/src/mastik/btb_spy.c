@@ -4,6 +4,7 @@
 #include <sel4/sel4.h>
 
 #include "../mastik_common/low.h"
+#include "../mastik_common/channel.h"
 #include <channel-bench/bench_common.h>
 #include <channel-bench/bench_types.h>
 
@@ -31,75 +32,37 @@ static void btb_jmp(uint32_t s) {
 
 }
 
-int btb_trojan(bench_env_t *env) {
+/*trojan: 3584 - 3712*/
+static uint32_t btb_secret(void *state) {
 
-  uint32_t total_sec = 128 + 1, secret;
-  seL4_MessageInfo_t info;
-  bench_args_t *args = env->args;
+  return (random() % (128 + 1)) + 3584; 
+}
 
-  /*receive the shared address to record the secret*/
-  volatile uint32_t *share_vaddr = (uint32_t *)args->shared_vaddr; 
+static void btb_encode(void *state, uint32_t secret) {
 
-  info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-  seL4_SetMR(0, 0); 
-  seL4_Send(args->r_ep, info);
+  btb_jmp(secret);
+}
 
-  /*ready to do the test*/
-  seL4_Send(args->ep, info);
+static uint32_t btb_probe_spy(void *state) {
 
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+  uint32_t start = probe_time(); 
 
-      /*waiting for a system tick*/
-      newTimeSlice();
+  btb_jmp(4096);
+  return probe_time() - start; 
+}
 
-      /*trojan: 3584 - 3712*/
-      secret = (random() % total_sec ) + 3584; 
-      /*do the probe*/
-      btb_jmp(secret);
+static const channel_t btb_channel = {
+  .secret = btb_secret,
+  .encode = btb_encode,
+  .probe = btb_probe_spy,
+};
 
-      /*update the secret read by low*/ 
-      *share_vaddr = secret; 
-  }
-  while (1);
+int btb_trojan(bench_env_t *env) {
 
-  return 0;
+  return channel_trojan(env, &btb_channel);
 }
 
-
 int btb_spy(bench_env_t *env) {
-  seL4_Word badge;
-  seL4_MessageInfo_t info;
-  uint32_t start; 
-  bench_args_t *args = env->args; 
-
-  /*the record address*/
-  struct bench_l1 *r_addr = (struct bench_l1 *)args->record_vaddr; 
-  /*the shared address*/
-  volatile uint32_t *secret = (uint32_t*)args->shared_vaddr; 
-
-  /*syn with trojan*/
-  info = seL4_Recv(args->ep, &badge);
-  assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
-
-
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
-
-      newTimeSlice();
-      start = rdtscp(); 
-      btb_jmp(4096);
-       
-      r_addr->result[i] = rdtscp() - start; 
-      r_addr->sec[i] = *secret; 
-
-  }
-
-  /*send result to manager, spy is done*/
-  info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-  seL4_SetMR(0, 0);
-  seL4_Send(args->r_ep, info);
-
-  while (1);
-
 
-  return 0;
+  return channel_spy(env, &btb_channel);
 }
@@ -12,6 +12,8 @@
 #include "../mastik_common/low.h"
 
 #define CHECKTIMES 16
+/*groups taken back by reduce() before it gives up on a set*/
+#define BACKTRACKS 32
 
 
 cachemap_t cm_pagelist(vlist_t pages);
@@ -42,9 +44,17 @@ static int timedwalk(void *list, register void *candidate) {
   return rv;
 }
 
+#ifdef CONFIG_BENCH_CACHEMAP_STATS
+/*eviction tests run by the current cm_linelist*/
+static int tests;
+#endif 
+
 static int checkevict(vlist_t es, void *candidate) {
   if (vl_len(es) == 0)
     return 0;
+#ifdef CONFIG_BENCH_CACHEMAP_STATS
+  tests++;
+#endif 
   for (int i = 0; i < vl_len(es); i++) 
     LNEXT(vl_get(es, i)) = vl_get(es, (i + 1) % vl_len(es));
   int timecur = timedwalk(vl_get(es, 0), candidate);
@@ -65,18 +75,55 @@ static void *expand(vlist_t es, vlist_t candidates) {
   return NULL;
 }
 
-static void contract(vlist_t es, vlist_t candidates, void *current) {
-  for (int i = 0; i < vl_len(es);) {
-    void *cand = vl_get(es, i);
-    vl_del(es, i);
-    clflush(current);
-    if (checkevict(es, current))
-      vl_push(candidates, cand);
-    else {
-      vl_insert(es, i, cand);
-      i++;
+/*Group testing: split es into assoc + 1 groups. As assoc lines are enough
+  to evict current, at least one group holds none of them, and can be moved
+  to spare. Repeat until only assoc lines are left, which takes about
+  assoc * log(|es| / assoc) rounds, rather than the |es| tests of removing
+  one line at a time. When no group can be dropped, a needed line went with
+  an earlier group on a noisy test, so that group is taken back. Gives up
+  after BACKTRACKS of those.*/
+static int reduce(vlist_t es, vlist_t spare, void *current, int assoc) {
+  vlist_t rest = vl_new();
+  /*sizes of the groups moved to spare, latest last*/
+  vlist_t dropped = vl_new();
+  int backtracks = 0;
+  int rv = 1;
+  while (vl_len(es) > assoc) {
+    int len = vl_len(es);
+    int groups = assoc + 1 < len ? assoc + 1 : len;
+    int g;
+    for (g = 0; g < groups; g++) {
+      int start = g * len / groups;
+      int end = (g + 1) * len / groups;
+      while (vl_len(rest))
+        vl_pop(rest);
+      for (int i = 0; i < len; i++)
+        if (i < start || i >= end)
+          vl_push(rest, vl_get(es, i));
+      clflush(current);
+      if (checkevict(rest, current)) {
+        for (int i = start; i < end; i++)
+          vl_push(spare, vl_get(es, i));
+        vl_push(dropped, (void *)(uintptr_t)(end - start));
+        while (vl_len(es))
+          vl_pop(es);
+        for (int i = 0; i < vl_len(rest); i++)
+          vl_push(es, vl_get(rest, i));
+        break;
+      }
+    }
+    if (g == groups) {
+      if (vl_len(dropped) == 0 || backtracks++ == BACKTRACKS) {
+        rv = 0;
+        break;
+      }
+      for (int n = (uintptr_t)vl_pop(dropped); n--; )
+        vl_push(es, vl_pop(spare));
     }
   }
+  vl_free(rest);
+  vl_free(dropped);
+  return rv;
 }
 
 static void collect(vlist_t es, vlist_t candidates, vlist_t set) {
@@ -90,33 +137,74 @@ static void collect(vlist_t es, vlist_t candidates, vlist_t set) {
 }
 
 
+#ifdef CONFIG_BENCH_CACHEMAP_STATS
+/*each set should evict its own lines (else a false negative) and not
+ those of the next set (else a false positive)*/
+static void cm_verify(cachemap_t cm, int *fn, int *fp) {
+  for (int i = 0; i < cm->nsets; i++) {
+    vlist_t set = cm->sets[i];
+    void *own = vl_pop(set);
+    void *other = vl_get(cm->sets[(i + 1) % cm->nsets], 0);
+    clflush(own);
+    if (!checkevict(set, own))
+      (*fn)++;
+    vl_push(set, own);
+    if (cm->nsets > 1) {
+      clflush(other);
+      if (checkevict(set, other))
+        (*fp)++;
+    }
+  }
+}
+
+static void cm_report(cachemap_t cm, ccnt_t cycles, int aborted) {
+  int fn = 0, fp = 0;
+  cm_verify(cm, &fn, &fp);
+  /*CPU_FEQ_MICROSEC is cycles per millisecond*/
+  printf("cachemap: %d sets in %llu cycles, %llu sets/s, %d tests, %d aborted, "
+      "%d/%d false negatives, %d/%d false positives\n", cm->nsets,
+      (unsigned long long)cycles,
+      cycles ? (unsigned long long)cm->nsets * CPU_FEQ_MICROSEC * 1000ull / cycles : 0ull,
+      tests, aborted, fn, cm->nsets, fp, cm->nsets > 1 ? cm->nsets : 0);
+}
+#endif /*CONFIG_BENCH_CACHEMAP_STATS*/
+
 cachemap_t cm_linelist(vlist_t lines) {
 #ifdef CONFIG_DEBUG_BUILD
   printf("%d lines\n", vl_len(lines));
+#endif 
+#ifdef CONFIG_BENCH_CACHEMAP_STATS
+  ccnt_t start = sel4bench_get_cycle_count();
+  int aborted = 0;
+  tests = 0;
 #endif 
   cachemap_t cm = (cachemap_t)malloc(sizeof(struct cachemap));
   assert(cm != NULL); 
   vlist_t sets = vl_new();
   vlist_t es = vl_new();
+  /*lines left over by the reduction of the last set, which seed the next*/
+  vlist_t spare = vl_new();
   int fail = 0;
-  while (vl_len(lines)) {
+  int assoc = geometry.l3.associativity;
+  while (vl_len(lines) || vl_len(spare)) {
       assert(vl_len(es) == 0);
       if (fail > 5) {
           break;
       }
+      while (vl_len(spare))
+          vl_push(es, vl_pop(spare));
       void *c = expand(es, lines);
-      if (c == NULL) {
-          while (vl_len(es))
-              vl_push(lines, vl_del(es, 0));
-          fail++;
-          continue;
-      }
-      contract(es, lines, c);
-      contract(es, lines, c);
-      contract(es, lines, c);
-      if (vl_len(es) > L3_ASSOCIATIVITY || vl_len(es) < L3_ASSOCIATIVITY - 3) {
+      if (c == NULL || !reduce(es, spare, c, assoc) || 
+              vl_len(es) < assoc - 3 || !checkevict(es, c)) {
+          if (c != NULL)
+              vl_push(lines, c);
           while (vl_len(es))
               vl_push(lines, vl_del(es, 0));
+          while (vl_len(spare))
+              vl_push(lines, vl_pop(spare));
+#ifdef CONFIG_BENCH_CACHEMAP_STATS
+          aborted++;
+#endif 
           fail++;
           continue;
       } 
@@ -124,6 +212,7 @@ cachemap_t cm_linelist(vlist_t lines) {
       vlist_t set = vl_new();
       vl_push(set, c);
       collect(es, lines, set);
+      collect(es, spare, set);
       while (vl_len(es))
           vl_push(set, vl_del(es, 0));
 #ifdef CONFIG_DEBUG_BUILD
@@ -131,6 +220,8 @@ cachemap_t cm_linelist(vlist_t lines) {
 #endif
       vl_push(sets, set);
   }
+  while (vl_len(spare))
+      vl_push(lines, vl_pop(spare));
 
   cm->nsets = vl_len(sets);
   cm->sets = (vlist_t *)calloc(cm->nsets, sizeof(vlist_t));
@@ -138,6 +229,9 @@ cachemap_t cm_linelist(vlist_t lines) {
       cm->sets[i] = vl_get(sets, i);
   vl_free(sets);
   vl_free(es);
+  vl_free(spare);
+#ifdef CONFIG_BENCH_CACHEMAP_STATS
+  cm_report(cm, sel4bench_get_cycle_count() - start, aborted);
+#endif 
   return cm;
 }
-
@@ -29,7 +29,7 @@ int l3_kd_spy(bench_env_t *env) {
 
     uint64_t prev = start;
     
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS;) {
+    for (int i = 0; i < env->args->data_points;) {
         ccnt_t cur = rdtscp_64(); 
         /*at the begining of the current tick*/
         if (cur - prev >= TS_THRESHOLD) {
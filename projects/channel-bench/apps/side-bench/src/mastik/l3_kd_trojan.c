@@ -92,7 +92,7 @@ int l3_kd_trojan(bench_env_t *env) {
     total_sec = cm->nsets * 64 + 1;
 
 
-    for (int n = 0; n < CONFIG_BENCH_DATA_POINTS; n++) {
+    for (int n = 0; n < env->args->data_points; n++) {
 
         newTimeSlice();
 
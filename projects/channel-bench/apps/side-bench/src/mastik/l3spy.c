@@ -75,12 +75,31 @@ int l3_spy(bench_env_t *env) {
     //Hold probing set for each API
     vlist_t probed[timing_api_num];
 
-    //Find the L3 eviction set
-    cachemap_t cm = map();
+    //The probe buffer placed by the root task, if any
+    char *buf = (char *)args->probe_vaddr; 
+    bench_probe_sets_t *saved = &probe_result->saved; 
 
-    //Individually find the probing set for each api
+    for(int i = 0; i < timing_api_num; i++)
+        probed[i] = vl_new();
+
+    //Reuse the probe sets found in that buffer by an earlier run
+    int stale[timing_api_num] = {0}; 
+    if (buf) 
+        saved->verified = reuse_probe_sets(saved, buf, probed, &caps, stale); 
+
+    //Search again for each api that has no sets, or lost any of its saved 
+    //ones, rather than run on with fewer sets than before
+    cachemap_t cm = NULL; 
     for(int i = 0; i < timing_api_num; i++){
 
+        if (vl_len(probed[i]) && !stale[i])
+            continue; 
+
+        //Find the L3 eviction set
+        if (!cm)
+            cm = buf ? map_buf(buf) : map();
+
+        vl_free(probed[i]); 
         probed[i] = search(cm, i, &caps);
     }
 
@@ -89,6 +108,9 @@ int l3_spy(bench_env_t *env) {
     remove_same_probesets(probed[timing_tcb], probed[timing_poll]); 
     remove_same_probesets(probed[timing_signal], probed[timing_poll]);
 
+    if (buf)
+        save_probe_sets(saved, buf, probed); 
+
     probe_result->probe_sets[timing_signal] = vl_len(probed[timing_signal]); 
     probe_result->probe_sets[timing_tcb] = vl_len(probed[timing_tcb]); 
     probe_result->probe_sets[timing_poll] = vl_len(probed[timing_poll]); 
@@ -109,7 +131,7 @@ int l3_spy(bench_env_t *env) {
     assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
     tick_start = rdtscp_64();
 
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for (int i = 0; i < env->args->data_points; i++) {
 
         waiting_probe(tick_start, i , true); 
 
@@ -170,7 +192,7 @@ int l3_trojan(bench_env_t *env) {
     seL4_Send(args->ep, info);
     tick_start = rdtscp_64();
 
-    for(int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for(int i = 0; i < env->args->data_points; i++) {
 
         waiting_probe(tick_start, i , false); 
 
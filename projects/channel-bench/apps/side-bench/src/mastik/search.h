@@ -13,7 +13,7 @@ static const char mask[] = ".....@@@@@@.....";
 
 #define SEARCHLEN 1000
 
-#define SIZE (16*1024*1024)
+#define SIZE BENCH_PROBE_BUFFER_SIZE
 
 static int a;
 
@@ -163,22 +163,12 @@ static int matchcount(const char *record, const char *match, int allowedmisses)
 }
 
 
-static cachemap_t map() {
+/*map the cache sets of a page aligned buffer of SIZE*/
+static cachemap_t map_buf(char *buf) {
     for (int i = 0; i < 1024*1024; i++)
         for (int j = 0; j < 1024; j++)
             a *=i+j;
 
-    char *buf = (char *)mmap(NULL, SIZE + 4096 * 2, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
-    if (buf == MAP_FAILED) {
-        return NULL; 
-    }
-    /*making the buffer page aligned*/
-    int buf_switch = (int)buf; 
-    buf_switch &= ~(0xfff); 
-    buf_switch += 0x1000; 
-    buf = (char *) buf_switch; 
-
-
     cachemap_t cm;
     vlist_t candidates;
     candidates = vl_new();
@@ -196,6 +186,80 @@ static cachemap_t map() {
 
 }
 
+static cachemap_t map() {
+
+    char *buf = (char *)mmap(NULL, SIZE + 4096 * 2, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
+    if (buf == MAP_FAILED) {
+        return NULL; 
+    }
+    /*making the buffer page aligned*/
+    int buf_switch = (int)buf; 
+    buf_switch &= ~(0xfff); 
+    buf_switch += 0x1000; 
+    buf = (char *) buf_switch; 
+
+    return map_buf(buf);
+}
+
+/*rebuild the probe sets saved by an earlier run in buf, keeping those 
+  that still conflict with the kernel, returns the number kept and counts
+  the sets of each API that were dropped in stale*/
+static int reuse_probe_sets(bench_probe_sets_t *saved, char *buf, 
+        vlist_t probed[], kernel_timing_caps_t *caps, int stale[]) {
+  int kept = 0;
+
+  for (int i = 0; i < saved->n; i++) {
+    bench_probe_set_t *set = saved->set + i;
+    vlist_t lines = vl_new();
+    pp_t pp;
+
+    if (set->api >= timing_api_num) {
+      vl_free(lines);
+      continue;
+    }
+
+    for (int l = 0; l < set->lines; l++) 
+      if (set->page[l] < SIZE / 4096)
+        vl_push(lines, buf + set->page[l] * 4096);
+
+    if (vl_len(lines) == set->lines) {
+      pp = pp_prepare(lines, set->lines, set->offset);
+      if (scan(pp, set->api, caps)) {
+        vl_push(probed[set->api], pp);
+        kept++;
+      } else 
+        stale[set->api]++;
+    } else 
+      stale[set->api]++;
+    vl_free(lines);
+  }
+  return kept;
+}
+
+/*record the probe sets as the pages of buf they are in, 
+  so that a later run can reuse them*/
+static void save_probe_sets(bench_probe_sets_t *saved, char *buf, 
+        vlist_t probed[]) {
+
+  saved->n = 0;
+  for (int api = 0; api < timing_api_num; api++) {
+    for (int i = 0; i < vl_len(probed[api]) && saved->n < BENCH_PROBE_SETS_MAX; i++) {
+      char *pp = vl_get(probed[api], i), *p = pp;
+      bench_probe_set_t *set = saved->set + saved->n++;
+
+      set->api = api;
+      set->offset = (uintptr_t)pp & 0xfff;
+      set->lines = 0;
+      /*walk the ring pp_prepare linked*/
+      do {
+        assert(set->lines < BENCH_PROBE_SET_LINES);
+        set->page[set->lines++] = (p - buf) / 4096;
+        p = *(char **)p;
+      } while (p != pp);
+    }
+  }
+}
+
 static void sample(pp_t pp, char *record, int samplecount) {
   pp_prime(pp, 50);
   uint32_t p = rdtscp();
@@ -220,7 +284,7 @@ static void attack(cachemap_t cm) {
   for (int offset = 0; offset < 4096; offset += 64) {
     for (int i = 0; i < cm->nsets; i++)
         /*page. colours*/
-      pps[i] = pp_prepare(cm->sets[i], L3_ASSOCIATIVITY, offset);
+      pps[i] = pp_prepare(cm->sets[i], geometry.l3.associativity, offset);
     printf("Trying offset 0x%03x\n", offset);
     for (int i = 0; i < cm->nsets; i++) {
       sample(pps[i], record, SEARCHLEN);
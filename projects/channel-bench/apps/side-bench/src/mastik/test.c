@@ -64,7 +64,7 @@ int mastik_test(int ac, char **av) {
 
   pp_t *pps[256];
   for (int i = 0; i < cm->nsets; i++)
-    pps[i] = pp_prepare(cm->sets[i], L3_ASSOCIATIVITY, 256);
+    pps[i] = pp_prepare(cm->sets[i], geometry.l3.associativity, 256);
 
   printf("Done preparing\n");
 
@@ -7,73 +7,38 @@
 #include <channel-bench/bench_types.h>
 #include <channel-bench/bench_helper.h>
 #include "../mastik_common/low.h"
+#include "../mastik_common/channel.h"
 
 extern uint32_t bp_probe(uint32_t secret);
 
 
-int bp_trojan(bench_env_t *env) {
-
-  uint32_t secret;
-  seL4_MessageInfo_t info;
-
-  bench_args_t *args = env->args; 
-  
-  volatile uint32_t *share_vaddr = (uint32_t *)args->shared_vaddr; 
-  
-  info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-  seL4_SetMR(0, 0); 
-  seL4_Send(args->r_ep, info);
-
-  /*ready to do the test*/
-  seL4_Send(args->ep, info);
-  
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
-
-      FENCE();
-      newTimeSlice();
-
-      secret = random() % 2;
-
-      X_64(bp_probe(secret);)
-      /*update the secret read by low*/ 
-      *share_vaddr = secret; 
-  }
+static uint32_t bp_secret(void *state) {
 
-  while (1);
- 
-  return 0;
+  return random() % 2;
 }
 
-int bp_spy(bench_env_t *env) {
-  seL4_Word badge;
-  seL4_MessageInfo_t info;
-  bench_args_t *args = env->args; 
+static void bp_encode(void *state, uint32_t secret) {
 
-  /*the record address*/
-  struct bench_l1 *r_addr = (struct bench_l1 *)args->record_vaddr; 
-  /*the shared address*/
-  volatile uint32_t *secret = (uint32_t *)args->shared_vaddr; 
+  X_64(bp_probe(secret);)
+}
 
-  /*syn with trojan*/
-  info = seL4_Recv(args->ep, &badge);
-  assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
+static uint32_t bp_probe_spy(void *state) {
 
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+  return bp_probe(0); 
+}
 
-      newTimeSlice();
-      /*result is the total probing cost
-        secret is updated by trojan in the previous system tick*/
-      r_addr->result[i] = bp_probe(0); 
-      r_addr->sec[i] = *secret; 
+static const channel_t bp_channel = {
+  .secret = bp_secret,
+  .encode = bp_encode,
+  .probe = bp_probe_spy,
+};
 
-  }
+int bp_trojan(bench_env_t *env) {
 
-  /*send result to manager, spy is done*/
-  info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-  seL4_SetMR(0, 0);
-  seL4_Send(args->r_ep, info);
+  return channel_trojan(env, &bp_channel);
+}
 
-  while (1);
+int bp_spy(bench_env_t *env) {
 
-  return 0;
+  return channel_spy(env, &bp_channel);
 }
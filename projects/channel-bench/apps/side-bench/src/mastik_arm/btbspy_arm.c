@@ -20,6 +20,7 @@
 #include <channel-bench/bench_helper.h>
 #include <channel-bench/bench_types.h>
 #include "../mastik_common/low.h"
+#include "../mastik_common/channel.h"
 
 /*using branch instructions to do the probe, 4 bytes aligned
   defined in branch_probe.S 
@@ -38,6 +39,9 @@ void branch_probe_lines(uint32_t n) {
     if (!n)
         return;
 
+    /*the probing code in branch_probe.S is laid out for BTAC_ENTRIES*/
+    assert(n <= BTAC_ENTRIES); 
+
     uint32_t start = (uint32_t)arm_branch_lines; 
 
     /*calculate where to start to probing if just one line, 
@@ -51,101 +55,37 @@ void branch_probe_lines(uint32_t n) {
 #endif
 }
 
-int btb_trojan(bench_env_t *env) {
-
-    uint32_t secret;
-    seL4_MessageInfo_t info;
-    bench_args_t *args = env->args; 
-
-    uint32_t volatile *share_vaddr = (uint32_t *)args->shared_vaddr; 
-    *share_vaddr = 0; 
+static uint32_t btb_secret(void *state) {
 
-    info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-    seL4_SetMR(0, 0); 
-    seL4_Send(args->r_ep, info);
+    return random() % (geometry.btac_entries + 1); 
+}
 
-    /*ready to do the test*/
-    seL4_Send(args->ep, info);
+/*using the instructions to probe*/
+static void btb_encode(void *state, uint32_t secret) {
 
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    branch_probe_lines(secret);
+}
 
-        FENCE(); 
-        newTimeSlice();
+static uint32_t btb_probe(void *state) {
 
-        secret = random() % (BTAC_ENTRIES  + 1); 
+    uint32_t start = probe_time(); 
 
-        /*using the instructions to probe*/
-        branch_probe_lines(secret);
+    branch_probe_lines(geometry.btac_entries);
+    return probe_time() - start; 
+}
 
-        /*update the secret read by low*/ 
-        *share_vaddr = secret; 
-    }
+static const channel_t btb_channel = {
+    .secret = btb_secret,
+    .encode = btb_encode,
+    .probe = btb_probe,
+};
 
-    while (1);
+int btb_trojan(bench_env_t *env) {
 
-    return 0;
+    return channel_trojan(env, &btb_channel);
 }
 
 int btb_spy(bench_env_t *env) {
 
-    seL4_Word badge;
-    seL4_MessageInfo_t info;
-    uint32_t start, after;
-#ifdef CONFIG_MANAGER_PMU_COUNTER 
-    ccnt_t volatile pmu_start; 
-    ccnt_t volatile pmu_end; 
-#endif
-    bench_args_t *args = env->args; 
-
-    struct bench_l1 *r_addr = (struct bench_l1 *)args->record_vaddr; 
-    /*the shared address*/
-    uint32_t volatile *secret = (uint32_t *)args->shared_vaddr; 
-
-    /*syn with trojan*/
-    info = seL4_Recv(args->ep, &badge);
-    assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
-
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
-
-        FENCE(); 
-        newTimeSlice();
-
-        //sel4bench_reset_cycle_count();
-#ifdef CONFIG_MANAGER_PMU_COUNTER 
-        pmu_start = sel4bench_get_counter(0);  
-#endif 
-        SEL4BENCH_READ_CCNT(start); 
-
-        /*using instrcutions to probe*/
-        branch_probe_lines(BTAC_ENTRIES);
-
-        SEL4BENCH_READ_CCNT(after);
-
-#ifdef CONFIG_MANAGER_PMU_COUNTER 
-        pmu_end = sel4bench_get_counter(0);  
-#endif 
-
-        r_addr->result[i] = after - start; 
-
-#ifdef CONFIG_MANAGER_PMU_COUNTER 
-        /*loading the pmu counter value */
-        for (int counter = 0; counter < BENCH_PMU_COUNTERS; counter++ )
-            r_addr->pmu[i][counter] = pmu_end - pmu_start; 
-
-#endif 
-        /*result is the total probing cost
-          secret is updated by trojan in the previous system tick*/
-        r_addr->sec[i] = *secret; 
-    }
-
-
-    /*send result to manager, spy is done*/
-    info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-    seL4_SetMR(0, 0);
-    seL4_Send(args->r_ep, info);
-
-    while (1);
-
-    return 0;
+    return channel_spy(env, &btb_channel);
 }
-
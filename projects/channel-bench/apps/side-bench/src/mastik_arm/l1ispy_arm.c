@@ -39,7 +39,7 @@ int l1i_trojan(bench_env_t *env) {
     /*ready to do the test*/
     seL4_Send(args->ep, info);
 
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for (int i = 0; i < env->args->data_points; i++) {
 
         FENCE(); 
         newTimeSlice();
@@ -104,7 +104,7 @@ int l1i_spy(bench_env_t *env) {
     info = seL4_Recv(args->ep, &badge);
     assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
 
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for (int i = 0; i < env->args->data_points; i++) {
 
         FENCE(); 
         newTimeSlice();
@@ -122,17 +122,18 @@ int l1i_spy(bench_env_t *env) {
         pmu_end = sel4bench_get_counter(0);  
 #endif 
 
-        r_addr->result[i] = after - start; 
+        r_addr->result[BENCH_RECORD_SLOT(i)] = after - start; 
 
 #ifdef CONFIG_MANAGER_PMU_COUNTER 
         /*loading the pmu counter value */
         for (int counter = 0; counter < BENCH_PMU_COUNTERS; counter++ )
-            r_addr->pmu[i][counter] = pmu_end - pmu_start; 
+            r_addr->pmu[BENCH_RECORD_SLOT(i)][counter] = pmu_end - pmu_start; 
 
 #endif 
         /*result is the total probing cost
           secret is updated by trojan in the previous system tick*/
-        r_addr->sec[i] = *secret; 
+        r_addr->sec[BENCH_RECORD_SLOT(i)] = *secret; 
+        bench_record_commit(r_addr, i);
     }
 
 #ifdef CONFIG_BENCH_COVERT_L1I_REWRITE
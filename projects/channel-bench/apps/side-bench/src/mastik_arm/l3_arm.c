@@ -46,8 +46,8 @@
 
 
 static void fillL3Info(l3pp_t l3) {
-    l3->l3info.associativity = L3_ASSOCIATIVITY;
-    l3->l3info.bufsize = L3_SIZE; 
+    l3->l3info.associativity = geometry.l3.associativity;
+    l3->l3info.bufsize = cache_size(&geometry.l3); 
 
 }
 
@@ -88,7 +88,7 @@ static void *sethead_single(l3pp_t l3, int set) {
         count = vl_len(list);
 
     /*offset within a group (page)*/
-    int offset = (set % l3->groupsize) * L3_CACHELINE;
+    int offset = (set % l3->groupsize) * geometry.l3.line;
 
     /*link all the lines in a set, forward,  circular link list*/
     /*It does not matter how many pages linked in the group,
@@ -109,7 +109,7 @@ static void *sethead(l3pp_t l3, int set) {
     if (count == 0 || vl_len(list) < count)
         count = vl_len(list);
     /*offset within a group (page)*/
-    int offset = (set % l3->groupsize) * L3_CACHELINE;
+    int offset = (set % l3->groupsize) * geometry.l3.line;
 
     /*link all the lines in a set, forward, and backward, circular link list*/
     /*It does not matter how many pages linked in the group,
@@ -406,7 +406,7 @@ static int probemap(l3pp_t l3) {
     vlist_t pages = vl_new();
 
     /*pushing every page into the pages list*/
-    for (int i = 0; i < l3->l3info.bufsize; i+= l3->groupsize * L3_CACHELINE) 
+    for (int i = 0; i < l3->l3info.bufsize; i+= l3->groupsize * geometry.l3.line) 
         vl_push(pages, l3->buffer + i);
 
     vlist_t groups = map(l3, pages);
@@ -599,9 +599,9 @@ void l3_probecount(l3pp_t l3, uint16_t *results) {
         int g = l3->monitoredset[i];
         /*prime the set using the buffer stroed in the group, identified 
          by the offset within a page*/
-        prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*L3_CACHELINE + 2*sizeof(void*), l3->l3info.associativity);
-        prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*L3_CACHELINE + 2*sizeof(void*), l3->l3info.associativity);
-        prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*L3_CACHELINE + 2*sizeof(void*), l3->l3info.associativity);
+        prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*geometry.l3.line + 2*sizeof(void*), l3->l3info.associativity);
+        prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*geometry.l3.line + 2*sizeof(void*), l3->l3info.associativity);
+        prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*geometry.l3.line + 2*sizeof(void*), l3->l3info.associativity);
     }
 
 }
@@ -617,9 +617,9 @@ void l3_bprobecount(l3pp_t l3, uint16_t *results) {
   for (int i = 0; i < l3->nmonitored; i++) {
     results[i] = bprobecount(l3->monitoredhead[i]);
     int g = l3->monitoredset[i];
-    prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*L3_CACHELINE + 2*sizeof(void*), l3->l3info.associativity);
-    prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*L3_CACHELINE + 2*sizeof(void*), l3->l3info.associativity);
-    prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*L3_CACHELINE + 2*sizeof(void*), l3->l3info.associativity);
+    prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*geometry.l3.line + 2*sizeof(void*), l3->l3info.associativity);
+    prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*geometry.l3.line + 2*sizeof(void*), l3->l3info.associativity);
+    prime(l3->groups[g/l3->groupsize], (g%l3->groupsize)*geometry.l3.line + 2*sizeof(void*), l3->l3info.associativity);
   }
 }
 
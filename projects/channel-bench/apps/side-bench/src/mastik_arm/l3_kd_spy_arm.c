@@ -45,7 +45,7 @@ int l3_kd_trojan(bench_env_t *env) {
 
     secret = 0; 
 
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for (int i = 0; i < env->args->data_points; i++) {
 
         FENCE(); 
         newTimeSlice();
@@ -99,7 +99,7 @@ int l3_kd_spy(bench_env_t *env) {
     uint32_t prev = start;
 
       
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS;) {
+    for (int i = 0; i < env->args->data_points;) {
          FENCE(); 
 
 
@@ -49,7 +49,7 @@ int l3_trojan_single(bench_env_t *env) {
     /*ready to do the test*/
     seL4_Send(args->ep, info);
 
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for (int i = 0; i < env->args->data_points; i++) {
 
         FENCE(); 
         newTimeSlice();
@@ -105,20 +105,21 @@ int l3_spy_single(bench_env_t *env) {
     info = seL4_Recv(args->ep, &badge);
     assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
 
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for (int i = 0; i < env->args->data_points; i++) {
 
         FENCE(); 
         newTimeSlice();
         
         l3_probe(l3, results);
-        r_addr->result[i] = 0; 
+        r_addr->result[BENCH_RECORD_SLOT(i)] = 0; 
         for (int s = 0; s < nsets; s++) {
-            r_addr->result[i] += results[s];
+            r_addr->result[BENCH_RECORD_SLOT(i)] += results[s];
         }
 
         /*result is the total probing cost
           secret is updated by trojan in the previous system tick*/
-        r_addr->sec[i] = *secret; 
+        r_addr->sec[BENCH_RECORD_SLOT(i)] = *secret; 
+        bench_record_commit(r_addr, i);
     }
     /*send result to manager, spy is done*/
     info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
@@ -201,7 +202,7 @@ int l3_spy(bench_env_t *env) {
     
     SEL4BENCH_READ_CCNT(tick_start);  
 
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for (int i = 0; i < env->args->data_points; i++) {
 
         newTimeSlice(); 
 
@@ -262,7 +263,7 @@ int l3_trojan(bench_env_t *env) {
     SEL4BENCH_READ_CCNT(tick_start);  
  
 
-    for(int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for(int i = 0; i < env->args->data_points; i++) {
 
         newTimeSlice(); 
        
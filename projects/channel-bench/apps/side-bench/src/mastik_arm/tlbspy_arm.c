@@ -15,6 +15,7 @@
 #include <channel-bench/bench_types.h>
 #include <channel-bench/bench_helper.h>
 #include "../mastik_common/low.h"
+#include "../mastik_common/channel.h"
 
 static inline void tlb_access(char *buf, uint32_t s) {
 
@@ -27,112 +28,51 @@ static inline void tlb_access(char *buf, uint32_t s) {
         char *addr = buf + i * PAGE_SIZE + random() % PAGE_SIZE; 
  
         /*align to a cache line size*/
-        addr = (void *)((uintptr_t)addr & ~(L1_CACHELINE - 1)); 
+        addr = (void *)((uintptr_t)addr & ~((uintptr_t)geometry.l1d.line - 1)); 
         low_access(addr);
     }
 
 }
 
-int tlb_trojan(bench_env_t *env) {
+static void *tlb_prepare(bench_args_t *args, bool spy) {
 
-    uint32_t secret;
-    seL4_MessageInfo_t info;
-    bench_args_t *args = env->args; 
-    
-    char *buf = malloc((TLB_ENTRIES * PAGE_SIZE) + PAGE_SIZE);
+    char *buf = malloc((geometry.tlb_entries * PAGE_SIZE) + PAGE_SIZE);
     assert(buf); 
 
-    buf = (char*)ALIGN_PAGE_SIZE(buf); 
+    return (void *)ALIGN_PAGE_SIZE(buf); 
+}
 
-    uint32_t volatile *share_vaddr = (uint32_t *)args->shared_vaddr; 
+static uint32_t tlb_secret(void *buf) {
 
-    info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-    seL4_SetMR(0, 0); 
-    seL4_Send(args->r_ep, info);
-    
+    return random() % (geometry.tlb_entries + 1); 
+}
 
-    /*ready to do the test*/
-    seL4_Send(args->ep, info);
-    secret = 0; 
+static void tlb_encode(void *buf, uint32_t secret) {
 
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    tlb_access(buf, secret);
+}
 
-        FENCE(); 
-        newTimeSlice();
+static uint32_t tlb_probe(void *buf) {
 
-        secret = random() % (TLB_ENTRIES + 1); 
+    uint32_t start = probe_time(); 
 
-        tlb_access(buf, secret);
+    tlb_access(buf, geometry.tlb_probe_pages);
+    return probe_time() - start; 
+}
 
-        /*update the secret read by low*/ 
-        *share_vaddr = secret; 
-    }
+static const channel_t tlb_channel = {
+    .prepare = tlb_prepare,
+    .secret = tlb_secret,
+    .encode = tlb_encode,
+    .probe = tlb_probe,
+};
 
-    while (1);
+int tlb_trojan(bench_env_t *env) {
 
-    return 0;
+    return channel_trojan(env, &tlb_channel);
 }
 
 int tlb_spy(bench_env_t *env) {
-  seL4_Word badge;
-  seL4_MessageInfo_t info;
-  ccnt_t start, after;
-#ifdef CONFIG_MANAGER_PMU_COUNTER 
-  uint32_t pmu_start[BENCH_PMU_COUNTERS]; 
-  uint32_t pmu_end[BENCH_PMU_COUNTERS]; 
-#endif 
-  bench_args_t *args = env->args; 
-
-  char *buf = malloc ((TLB_ENTRIES  * PAGE_SIZE) + PAGE_SIZE);
-  assert(buf); 
-
-  buf = (char*)ALIGN_PAGE_SIZE(buf); 
-
-  struct bench_l1 *r_addr = (struct bench_l1 *)args->record_vaddr; 
-  /*the shared address*/
-  uint32_t volatile *secret = (uint32_t *)args->shared_vaddr; 
-
-  /*syn with trojan*/
-  info = seL4_Recv(args->ep, &badge);
-  assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
-
-
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
-      FENCE(); 
-      newTimeSlice();
-
-#ifdef CONFIG_MANAGER_PMU_COUNTER 
-      sel4bench_get_counters(BENCH_PMU_BITS, pmu_start);  
-#endif 
-      SEL4BENCH_READ_CCNT(start);  
-
-      tlb_access(buf, TLB_PROBE_PAGES);
-      
-      SEL4BENCH_READ_CCNT(after);  
-     
-#ifdef CONFIG_MANAGER_PMU_COUNTER 
-      sel4bench_get_counters(BENCH_PMU_BITS, pmu_end);  
-#endif 
-
-      r_addr->result[i] = after - start; 
-      /*result is the total probing cost
-        secret is updated by trojan in the previous system tick*/
-      r_addr->sec[i] = *secret;
-
-#ifdef CONFIG_MANAGER_PMU_COUNTER 
-      /*loading the pmu counter value */
-      for (int counter = 0; counter < BENCH_PMU_COUNTERS; counter++ )
-          r_addr->pmu[i][counter] = pmu_end[counter] - pmu_start[counter]; 
-#endif 
-  
-  }
-  /*send result to manager, spy is done*/
-  info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-  seL4_SetMR(0, 0);
-  seL4_Send(args->r_ep, info);
-
-  while (1);
-
-  return 0;
-}
 
+    return channel_spy(env, &tlb_channel);
+}
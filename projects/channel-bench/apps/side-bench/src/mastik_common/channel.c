@@ -0,0 +1,124 @@
+/*the trojan and spy of the covert channels, shared by all architectures,
+  driving the probe kernels of a channel_t backend*/
+
+#include <autoconf.h>
+#include <manager/gen_config.h>
+#include <side-bench/gen_config.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sel4/sel4.h>
+#include <channel-bench/bench_common.h>
+#include <channel-bench/bench_types.h>
+#include <channel-bench/bench_helper.h>
+#include "low.h"
+#include "channel.h"
+
+static inline void progress(const char *who, int i, int points) {
+#ifdef CONFIG_ARCH_RISCV
+    if (i % 1000 == 0 || (i - 1) % 1000 == 0 || i == points - 1)
+        printf("%s: Data point %d\n", who, i);
+#endif
+}
+
+int channel_trojan(bench_env_t *env, const channel_t *c) {
+
+    seL4_MessageInfo_t info;
+    bench_args_t *args = env->args;
+    uint32_t secret;
+
+    void *state = c->prepare ? c->prepare(args, false) : NULL;
+
+    /*the secret read by the spy*/
+    uint32_t volatile *share_vaddr = (uint32_t *)args->shared_vaddr;
+    *share_vaddr = 0;
+
+    /*manager: trojan is ready*/
+    info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
+    seL4_SetMR(0, 0);
+    seL4_Send(args->r_ep, info);
+
+    /*syn with spy*/
+    seL4_Send(args->ep, info);
+
+    for (int i = 0; i < args->data_points; i++) {
+
+        progress("TROJAN", i, args->data_points);
+
+        FENCE();
+        /*waiting for a system tick*/
+        newTimeSlice();
+
+        secret = c->secret(state);
+        c->encode(state, secret);
+
+        /*update the secret read by low*/
+        *share_vaddr = secret;
+    }
+
+    while (1);
+
+    return 0;
+}
+
+int channel_spy(bench_env_t *env, const channel_t *c) {
+
+    seL4_Word badge;
+    seL4_MessageInfo_t info;
+    bench_args_t *args = env->args;
+    uint32_t result;
+
+    ccnt_t UNUSED pmu_start[BENCH_PMU_COUNTERS];
+    ccnt_t UNUSED pmu_end[BENCH_PMU_COUNTERS];
+
+    void *state = c->prepare ? c->prepare(args, true) : NULL;
+
+    /*the record address*/
+    struct bench_l1 *r_addr = (struct bench_l1 *)args->record_vaddr;
+    /*the shared address*/
+    uint32_t volatile *secret = (uint32_t *)args->shared_vaddr;
+
+    /*syn with trojan*/
+    info = seL4_Recv(args->ep, &badge);
+    assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
+
+    for (int i = 0; i < args->data_points; i++) {
+
+        progress("SPY", i, args->data_points);
+
+        FENCE();
+        newTimeSlice();
+
+#ifdef CONFIG_MANAGER_PMU_COUNTER
+        sel4bench_get_counters(BENCH_PMU_BITS, pmu_start);
+#endif
+
+        result = c->probe(state);
+
+#ifdef CONFIG_MANAGER_PMU_COUNTER
+        sel4bench_get_counters(BENCH_PMU_BITS, pmu_end);
+        /*loading the pmu counter value */
+        for (int counter = 0; counter < BENCH_PMU_COUNTERS; counter++ )
+            r_addr->pmu[BENCH_RECORD_SLOT(i)][counter] = pmu_end[counter] - pmu_start[counter];
+#endif
+
+        /*result is the total probing cost
+          secret is updated by trojan in the previous system tick*/
+        r_addr->result[BENCH_RECORD_SLOT(i)] = result;
+        r_addr->sec[BENCH_RECORD_SLOT(i)] = *secret;
+        bench_record_commit(r_addr, i);
+
+        if (c->prime)
+            c->prime(state);
+    }
+
+    /*send result to manager, spy is done*/
+    info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
+    seL4_SetMR(0, 0);
+    seL4_Send(args->r_ep, info);
+
+    while (1);
+
+    return 0;
+}
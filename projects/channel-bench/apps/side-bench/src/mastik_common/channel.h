@@ -0,0 +1,28 @@
+#ifndef __CHANNEL_H__
+#define __CHANNEL_H__ 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <channel-bench/bench_types.h>
+
+/*A covert channel backend, run by channel_trojan() and channel_spy().
+  In every time slice the trojan leaves the footprint of a secret, and
+  the spy probes in the next one, recording the probing cost with the
+  secret of the slice before. A backend only gives the probe kernels.*/
+typedef struct channel {
+    /*optional: set up the trojan or the spy, returning its state*/
+    void *(*prepare)(bench_args_t *args, bool spy);
+    /*trojan: pick the next secret*/
+    uint32_t (*secret)(void *state);
+    /*trojan: leave the footprint of the secret*/
+    void (*encode)(void *state, uint32_t secret);
+    /*spy: probe the footprint, returning the cost*/
+    uint32_t (*probe)(void *state);
+    /*spy, optional: reset the channel after probing*/
+    void (*prime)(void *state);
+} channel_t;
+
+int channel_trojan(bench_env_t *env, const channel_t *c);
+int channel_spy(bench_env_t *env, const channel_t *c);
+
+#endif // __CHANNEL_H__
@@ -0,0 +1,139 @@
+/*The cache geometry used by the probing code.
+
+  It is filled once at start up: whatever the root task describes in
+  bench_args_t is taken as it is, fields left 0 are read from the cpuid cache
+  descriptors on x86, and anything still unknown falls back to the per-platform
+  description in low.h. A single image can then probe any level of any of the
+  supported parts, instead of being built for one of them.*/
+
+#include <autoconf.h>
+#include <manager/gen_config.h>
+#include <side-bench/gen_config.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include <channel-bench/bench_common.h>
+#include <channel-bench/bench_types.h>
+#include "low.h"
+#include "geometry.h"
+
+bench_geometry_t geometry;
+
+static void fill_level(bench_cache_level_t *c, uint32_t associativity, 
+        uint32_t sets, uint32_t line) {
+
+    if (!c->associativity)
+        c->associativity = associativity; 
+    if (!c->sets)
+        c->sets = sets; 
+    if (!c->line)
+        c->line = line; 
+}
+
+static void fill(uint32_t *v, uint32_t d) {
+
+    if (!*v)
+        *v = d; 
+}
+
+#ifdef CONFIG_ARCH_X86
+/*the deterministic cache parameters leaf, one sub-leaf for each cache*/
+static void cpuid_geometry(bench_geometry_t *g) {
+
+    for (uint32_t i = 0; ; i++) {
+        union {
+            struct cpuidRegs regs; 
+            struct cacheInfo info; 
+        } c; 
+        bench_cache_level_t *level = NULL; 
+
+        c.regs.eax = CPUID_CACHEINFO; 
+        c.regs.ebx = c.regs.edx = 0; 
+        c.regs.ecx = i; 
+        cpuid(&c.regs); 
+
+        if (c.info.type == CACHETYPE_NULL)
+            break; 
+        if (c.info.type == CACHETYPE_INSTRUCTION)
+            continue; 
+
+        switch (c.info.level) {
+            case 1: 
+                level = &g->l1d; 
+                break; 
+            case 2: 
+                level = &g->l2; 
+                break; 
+            case 3: 
+                level = &g->l3; 
+                break; 
+            default: 
+                continue; 
+        }
+
+        fill_level(level, c.info.associativity + 1, c.info.sets + 1, 
+                c.info.lineSize + 1); 
+    }
+}
+#endif /*CONFIG_ARCH_X86*/
+
+/*the compiled in description of the benchmarking platform*/
+static void default_geometry(bench_geometry_t *g) {
+
+    fill_level(&g->l1d, L1_ASSOCIATIVITY, L1_SETS, L1_CACHELINE); 
+#ifdef L2_SETS 
+    fill_level(&g->l2, L2_ASSOCIATIVITY, L2_SETS, L2_CACHELINE); 
+#endif 
+#ifdef L3_CACHELINE 
+    fill_level(&g->l3, L3_ASSOCIATIVITY, 
+            L3_SIZE / (L3_ASSOCIATIVITY * L3_CACHELINE), L3_CACHELINE); 
+#else 
+    fill_level(&g->l3, L3_ASSOCIATIVITY, L3_SETS, L1_CACHELINE); 
+#endif 
+#ifdef TLB_ENTRIES 
+    fill(&g->tlb_entries, TLB_ENTRIES); 
+    fill(&g->tlb_probe_pages, TLB_PROBE_PAGES); 
+#endif 
+#ifdef BTAC_ENTRIES 
+    fill(&g->btac_entries, BTAC_ENTRIES); 
+#endif 
+}
+
+void geometry_init(bench_args_t *args) {
+
+    geometry = args->geometry; 
+
+#ifdef CONFIG_ARCH_X86
+    cpuid_geometry(&geometry); 
+#endif 
+    default_geometry(&geometry); 
+
+#ifdef CONFIG_DEBUG_BUILD
+    printf("geometry: l1d %u/%u/%u l2 %u/%u/%u l3 %u/%u/%u tlb %u/%u btac %u\n", 
+            geometry.l1d.associativity, geometry.l1d.sets, geometry.l1d.line, 
+            geometry.l2.associativity, geometry.l2.sets, geometry.l2.line, 
+            geometry.l3.associativity, geometry.l3.sets, geometry.l3.line, 
+            geometry.tlb_entries, geometry.tlb_probe_pages, 
+            geometry.btac_entries); 
+#endif 
+}
+
+/*the level that the prime+probe code in l1.c works on for a test*/
+bench_cache_level_t *geometry_prime_level(int test_num) {
+
+    bench_cache_level_t *c = &geometry.l1d; 
+
+    if (test_num == BENCH_COVERT_L2_TROJAN || test_num == BENCH_COVERT_L2_SPY ||
+            test_num == BENCH_CACHE_FLUSH_L2)
+        c = &geometry.l2; 
+
+#ifdef CONFIG_BENCH_COVERT_L2_KERNEL_SCHEDULE 
+    /*the trojan of the kernel schedule channel sends through the L2*/
+    if (test_num == BENCH_COVERT_LLC_KD_TROJAN)
+        c = &geometry.l2; 
+#endif 
+
+    /*no description for this level on this platform*/
+    assert(c->associativity && c->sets && c->line); 
+    return c; 
+}
@@ -0,0 +1,31 @@
+#ifndef __GEOMETRY_H__
+#define __GEOMETRY_H__ 1
+
+#include <stddef.h>
+#include <channel-bench/bench_common.h>
+#include <channel-bench/bench_types.h>
+
+/*the largest number of sets the prime+probe code in l1.c can monitor*/
+#define GEOMETRY_MAX_SETS  2048
+
+/*the cache geometry of this platform, filled by geometry_init*/
+extern bench_geometry_t geometry;
+
+void geometry_init(bench_args_t *args);
+bench_cache_level_t *geometry_prime_level(int test_num);
+
+/*bytes covered by one way of the cache level*/
+static inline size_t cache_way_size(bench_cache_level_t *c) {
+    return (size_t)c->sets * c->line;
+}
+
+static inline size_t cache_size(bench_cache_level_t *c) {
+    return cache_way_size(c) * c->associativity;
+}
+
+/*a buffer covering every line of the level after page alignment*/
+static inline size_t cache_probe_buffer(bench_cache_level_t *c) {
+    return cache_size(c) + BENCH_PAGE_SIZE;
+}
+
+#endif // __GEOMETRY_H__
@@ -10,22 +10,14 @@
 #include "l1.h"
 
 
-#define PTR(set, way, ptr) (void *)(((uintptr_t)l1->memory) + ((set) * L1_CACHELINE) + ((way) * L1_STRIDE) + ((ptr)*sizeof(void *)))
+#define PTR(set, way, ptr) (void *)(((uintptr_t)l1->memory) + ((set) * l1->level.line) + ((way) * l1->stride) + ((ptr)*sizeof(void *)))
 #define LNEXT(p) (*(void **)(p))
 
 static int probelist(void *pp, int segments, int seglen, uint16_t *results) {
   void *p = pp;
   uint32_t s, res; 
   while (segments--) {
-#ifdef CONFIG_ARCH_ARM
-      SEL4BENCH_READ_CCNT(s); 
-#endif 
-#ifdef CONFIG_ARCH_X86
-      s = rdtscp();
-#endif 
-#ifdef CONFIG_ARCH_RISCV
-      s = rdtime();
-#endif
+      s = probe_time();
       for (int i = seglen; i--; ) {
           // Under normal circumstances, p is never NULL. 
           // We need this test to ensure the optimiser does not kill the whole loop...
@@ -36,16 +28,7 @@ static int probelist(void *pp, int segments, int seglen, uint16_t *results) {
 #endif    
           p = LNEXT(p);
       }
-#ifdef CONFIG_ARCH_ARM 
-      SEL4BENCH_READ_CCNT(res); 
-      res -= s; 
-#endif 
-#ifdef CONFIG_ARCH_X86
-    res = rdtscp() - s;
-#endif
-#ifdef CONFIG_ARCH_RISCV
-    res = rdtime() - s;
-#endif
+      res = probe_time() - s;
     *results = res > UINT16_MAX ? UINT16_MAX : res;
     results++;
   }
@@ -66,21 +49,223 @@ static void *primelist(void *p, int segments, int seglen) {
   return p;
 }
 
-l1info_t l1_prepare(uint64_t *monitored_sets) {
+/*Kernels unrolled for the common associativities: walking a set is a 
+  straight run of dependent loads, and the loop and NULL test of 
+  probelist() no longer leave their own footprint in the L1-I and the 
+  branch predictor. As in bp.S and btb.S, macros do the repetition.*/
+#define WAYS_2(a)  a a
+#define WAYS_4(a)  WAYS_2(a) WAYS_2(a)
+#define WAYS_8(a)  WAYS_4(a) WAYS_4(a)
+#define WAYS_12(a) WAYS_8(a) WAYS_4(a)
+#define WAYS_16(a) WAYS_8(a) WAYS_8(a)
+#define WAYS_20(a) WAYS_16(a) WAYS_4(a)
+
+#ifdef CONFIG_BENCH_COVERT_L1D_WRITE
+#define PROBE_STEP(p) *(uint32_t*) ((uint32_t*)(p) + 4) = 0xff; (p) = LNEXT(p);
+#else
+#define PROBE_STEP(p) (p) = LNEXT(p);
+#endif
+
+#define L1_KERNEL(ways) \
+static int probelist_##ways(void *pp, int segments, uint16_t *results) { \
+  void *p = pp; \
+  uint32_t s, res; \
+  while (segments--) { \
+    s = probe_time(); \
+    WAYS_##ways(PROBE_STEP(p)) \
+    res = probe_time() - s; \
+    *results++ = res > UINT16_MAX ? UINT16_MAX : res; \
+  } \
+  return p == pp; \
+} \
+static int probestamps_##ways(void *pp, int segments, uint16_t *stamps, uint16_t *start) { \
+  PROBE_BATCHED(WAYS_##ways(PROBE_STEP(p))) \
+} \
+static void *primelist_##ways(void *p, int segments) { \
+  while (segments--) { \
+    WAYS_##ways(p = LNEXT(p);) \
+  } \
+  return p; \
+}
+
+/*Batched timestamps: the counter is read once per set, at the end of
+  its walk, and the start is kept in a register. Four 16-bit stamps are
+  held in registers and spilled with one store into the stamp lines,
+  which are warmed before the probe and sit in sets of their own, so the
+  probe no longer writes into the sets it is timing. The costs are the
+  differences of the stamps, taken after the probe. A set costing more
+  than UINT16_MAX cycles wraps instead of saturating.*/
+#define STAMP_SET(walk, t) walk t = probe_time();
+
+#define PROBE_BATCHED(walk) \
+  void *p = pp; \
+  uint64_t *line = (uint64_t *)stamps; \
+  int n = segments; \
+  *start = probe_time(); \
+  for (; n >= 4; n -= 4) { \
+    uint16_t t0, t1, t2, t3; \
+    STAMP_SET(walk, t0) STAMP_SET(walk, t1) \
+    STAMP_SET(walk, t2) STAMP_SET(walk, t3) \
+    *line++ = t0 | (uint64_t)t1 << 16 | (uint64_t)t2 << 32 | (uint64_t)t3 << 48; \
+  } \
+  stamps = (uint16_t *)line; \
+  while (n--) { \
+    STAMP_SET(walk, *stamps) \
+    stamps++; \
+  } \
+  return p == pp;
+
+#define LOOP_STEP(p) \
+  for (int i = seglen; i--; ) { \
+    if (p == NULL) \
+      break; \
+    PROBE_STEP(p) \
+  }
+
+static int probestamps(void *pp, int segments, int seglen, uint16_t *stamps, uint16_t *start) {
+  PROBE_BATCHED(LOOP_STEP(p))
+}
+
+L1_KERNEL(2)
+L1_KERNEL(4)
+L1_KERNEL(8)
+L1_KERNEL(12)
+L1_KERNEL(16)
+L1_KERNEL(20)
+
+struct l1_kernel {
+  int ways;
+  int (*probe)(void *pp, int segments, uint16_t *results);
+  int (*stamps)(void *pp, int segments, uint16_t *stamps, uint16_t *start);
+  void *(*prime)(void *p, int segments);
+};
+
+#define L1_KERNEL_ENTRY(ways) {ways, probelist_##ways, probestamps_##ways, primelist_##ways}
+
+static const struct l1_kernel kernels[] = {
+  L1_KERNEL_ENTRY(2),
+  L1_KERNEL_ENTRY(4),
+  L1_KERNEL_ENTRY(8),
+  L1_KERNEL_ENTRY(12),
+  L1_KERNEL_ENTRY(16),
+  L1_KERNEL_ENTRY(20),
+};
+
+/*the unrolled kernel for the associativity, NULL for the loops*/
+static const struct l1_kernel *l1_kernel(int ways) {
+  for (int i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++)
+    if (kernels[i].ways == ways)
+      return kernels + i;
+  return NULL;
+}
+
+/*the stamp lines, one stamp per set, take the last sets of the level*/
+static int l1_stamp_sets(bench_cache_level_t *level) {
+  return (level->sets * sizeof(uint16_t) + level->line - 1) / level->line;
+}
+
+static void l1_warm_stamps(l1info_t l1) {
+  for (int i = 0; i < l1->stamp_sets; i++)
+    *(volatile uint16_t *)((uintptr_t)l1->stamps + i * l1->level.line) = 0;
+}
+
+static int l1_probe_stamps(l1info_t l1, void *list, uint16_t *results) {
+  uint16_t start;
+  int ret;
+
+  l1_warm_stamps(l1);
+  if (l1->kernel)
+    ret = l1->kernel->stamps(list, l1->nsets, l1->stamps, &start);
+  else
+    ret = probestamps(list, l1->nsets, l1->level.associativity, l1->stamps, &start);
+
+  /*spill: the cost of a set is the distance to the stamp before it*/
+  for (int i = 0; i < l1->nsets; i++) {
+    results[i] = l1->stamps[i] - start;
+    start = l1->stamps[i];
+  }
+  return ret;
+}
+
+struct noise_floor {
+  uint32_t min, max;
+  uint64_t sum, n;
+};
+
+static void noise_floor_add(struct noise_floor *f, uint16_t *results, int nsets) {
+  for (int i = 0; i < nsets; i++) {
+    if (results[i] < f->min)
+      f->min = results[i];
+    if (results[i] > f->max)
+      f->max = results[i];
+    f->sum += results[i];
+    f->n++;
+  }
+}
+
+/*the noise floor: the cost of probing primed sets, all hits, with a
+  timestamp pair around every set and with batched timestamps. both
+  include the counter overhead that measure_overhead() finds; anything
+  cheaper means the timestamps do not bracket the loads*/
+static void l1_noise_floor(l1info_t l1) {
+  ccnt_t overhead;
+  struct noise_floor pair = {UINT16_MAX, 0, 0, 0};
+  struct noise_floor batched = {UINT16_MAX, 0, 0, 0};
+  uint16_t *results = malloc(l1->nsets * sizeof(uint16_t));
+
+  assert(results);
+  measure_overhead(&overhead);
+
+  for (int r = 0; r < WARMUP_ROUNDS / 64; r++) {
+    l1_prime(l1);
+    if (l1->kernel)
+      l1->kernel->probe(l1->fwdlist, l1->nsets, results);
+    else
+      probelist(l1->fwdlist, l1->nsets, l1->level.associativity, results);
+    noise_floor_add(&pair, results, l1->nsets);
+
+    l1_prime(l1);
+    l1_probe_stamps(l1, l1->fwdlist, results);
+    noise_floor_add(&batched, results, l1->nsets);
+  }
+  free(results);
+
+  printf("l1: %d ways, %s kernel, counter overhead %llu\n",
+      l1->level.associativity, l1->kernel ? "unrolled" : "loop",
+      (unsigned long long)overhead);
+  printf("l1: primed set, timestamp pair min %u mean %llu max %u, batched min %u mean %llu max %u\n",
+      pair.min, (unsigned long long)(pair.sum / pair.n), pair.max,
+      batched.min, (unsigned long long)(batched.sum / batched.n), batched.max);
+  if (pair.min < overhead)
+    printf("l1: primed set cheaper than the counter overhead\n");
+}
+
+l1info_t l1_prepare(bench_cache_level_t *level, uint64_t *monitored_sets) {
+  assert(level->sets <= GEOMETRY_MAX_SETS);
   l1info_t l1 = (l1info_t)malloc(sizeof(struct l1info));
-  l1->memory = mmap(0, L1_PROBE_BUFFER, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
+  l1->level = *level;
+  l1->stride = cache_way_size(level);
+  /*one more way for the stamp lines*/
+  l1->memory = mmap(0, cache_probe_buffer(level) + l1->stride, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
   l1->memory = (void *)((((uintptr_t)l1->memory) + 0xfff) & ~0xfff);
 
   assert((((uintptr_t)l1->memory) & 0xfff) == 0);
   l1->fwdlist = NULL;
   l1->bkwlist = NULL;
-  for (int set = 0; set < L1_SETS; set++) {
-    for (int way = 0; way < L1_ASSOCIATIVITY - 1; way++) {
+  for (int set = 0; set < l1->level.sets; set++) {
+    for (int way = 0; way < l1->level.associativity - 1; way++) {
       LNEXT(PTR(set, way, 0)) = PTR(set, way+1, 0);
       LNEXT(PTR(set, way+1, 1)) = PTR(set, way, 1);
     }
   }
+  l1->kernel = l1_kernel(l1->level.associativity);
+  l1->stamp_sets = l1_stamp_sets(level);
+  l1->stamps = PTR(level->sets - l1->stamp_sets, level->associativity, 0);
   l1_set_monitored_set(l1, monitored_sets);
+#ifdef CONFIG_DEBUG_BUILD
+  if (l1->nsets)
+    l1_noise_floor(l1);
+#endif
   return l1;
 }
 
@@ -95,7 +280,15 @@ void l1_set_monitored_set(l1info_t l1, uint64_t *monitored_sets) {
         l1->monitored_sets[i] = monitored_sets[i];
   
         for (int j = 0; j < 64; j++) {
-            if (monitored_sets[i] & (1ULL << j)) {
+            /*sets beyond the level are never monitored*/
+            if (i * 64 + j >= l1->level.sets)
+                l1->monitored_sets[i] &= ~(1ULL << j);
+#ifdef CONFIG_BENCH_COVERT_L1D_BATCHED
+            /*nor are the sets of the stamp lines*/
+            else if (i * 64 + j >= l1->level.sets - l1->stamp_sets)
+                l1->monitored_sets[i] &= ~(1ULL << j);
+#endif
+            else if (monitored_sets[i] & (1ULL << j)) {
                 l1->monitored[nsets++] = i * 64 + j;
 
             }
@@ -116,26 +309,41 @@ void l1_randomise(l1info_t l1) {
   }
 
   for (int i = 0; i < l1->nsets - 1; i++) {
-    LNEXT(PTR(l1->monitored[i], L1_ASSOCIATIVITY - 1, 0)) = PTR(l1->monitored[i+1], 0, 0);
-    LNEXT(PTR(l1->monitored[i], 0, 1)) = PTR(l1->monitored[i+1], L1_ASSOCIATIVITY - 1, 1);
+    LNEXT(PTR(l1->monitored[i], l1->level.associativity - 1, 0)) = PTR(l1->monitored[i+1], 0, 0);
+    LNEXT(PTR(l1->monitored[i], 0, 1)) = PTR(l1->monitored[i+1], l1->level.associativity - 1, 1);
   }
-  l1->fwdlist = LNEXT(PTR(l1->monitored[l1->nsets - 1], L1_ASSOCIATIVITY - 1, 0)) = PTR(l1->monitored[0], 0, 0);
-  l1->bkwlist = LNEXT(PTR(l1->monitored[l1->nsets - 1], 0, 1)) = PTR(l1->monitored[0], L1_ASSOCIATIVITY - 1, 1);
+  l1->fwdlist = LNEXT(PTR(l1->monitored[l1->nsets - 1], l1->level.associativity - 1, 0)) = PTR(l1->monitored[0], 0, 0);
+  l1->bkwlist = LNEXT(PTR(l1->monitored[l1->nsets - 1], 0, 1)) = PTR(l1->monitored[0], l1->level.associativity - 1, 1);
 
 }
 
 int l1_probe(l1info_t l1, uint16_t *results) {
-  return probelist(l1->fwdlist, l1->nsets, L1_ASSOCIATIVITY, results);
+#ifdef CONFIG_BENCH_COVERT_L1D_BATCHED
+  return l1_probe_stamps(l1, l1->fwdlist, results);
+#else
+  if (l1->kernel)
+    return l1->kernel->probe(l1->fwdlist, l1->nsets, results);
+  return probelist(l1->fwdlist, l1->nsets, l1->level.associativity, results);
+#endif
 }
 
 
 
 void l1_bprobe(l1info_t l1, uint16_t *results) {
-  probelist(l1->bkwlist, l1->nsets, L1_ASSOCIATIVITY, results);
+#ifdef CONFIG_BENCH_COVERT_L1D_BATCHED
+  l1_probe_stamps(l1, l1->bkwlist, results);
+#else
+  if (l1->kernel)
+    l1->kernel->probe(l1->bkwlist, l1->nsets, results);
+  else
+    probelist(l1->bkwlist, l1->nsets, l1->level.associativity, results);
+#endif
 }
 
 
 void *l1_prime(l1info_t l1) {
-  return primelist(l1->fwdlist, l1->nsets, L1_ASSOCIATIVITY);
+  if (l1->kernel)
+    return l1->kernel->prime(l1->fwdlist, l1->nsets);
+  return primelist(l1->fwdlist, l1->nsets, l1->level.associativity);
 }
 
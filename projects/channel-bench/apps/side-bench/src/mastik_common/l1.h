@@ -3,7 +3,7 @@
 
 typedef struct l1info *l1info_t;
 
-l1info_t l1_prepare(uint64_t *monitored_sets);
+l1info_t l1_prepare(bench_cache_level_t *level, uint64_t *monitored_sets);
 void l1_set_monitored_set(l1info_t l1, uint64_t *monitored_sets);
 void l1_randomise(l1info_t l1);
 int l1_probe(l1info_t l1, uint16_t *results);
@@ -20,14 +20,21 @@ void *l1_prime(l1info_t l1);
 #include <assert.h>
 #include "low.h"
 /*using bitmask 64 bit wide to record the monitored sets*/
-#define MONITOR_MASK (L1_SETS / 64)
+#define MONITOR_MASK (GEOMETRY_MAX_SETS / 64)
+
+struct l1_kernel;
 
 struct l1info{
   void *memory;
   void *fwdlist;
   void *bkwlist;
+  bench_cache_level_t level;
+  size_t stride;
+  const struct l1_kernel *kernel;   /*unrolled for the associativity, or NULL*/
+  uint16_t *stamps;                 /*the stamp lines of the batched probe*/
+  int stamp_sets;
   uint64_t monitored_sets[MONITOR_MASK];
-  uint16_t monitored[L1_SETS];
+  uint16_t monitored[GEOMETRY_MAX_SETS];
   int nsets;
 };
 
@@ -257,7 +257,7 @@ void l1i_probe(l1iinfo_t l1, uint16_t *results) {
 
     for (int i = 0; i < l1->nsets; i++) {
         //printf("l1i_probe: i = %d\n", i);
-        start = rdtime();
+        start = bench_timestamp();
         // Using assembly because I am not sure I can trust the compiler
         //asm volatile ("callq %0": : "r" (SET(0, l1->monitored[i])):);
 
@@ -266,7 +266,7 @@ void l1i_probe(l1iinfo_t l1, uint16_t *results) {
         //printf("BREAK NOW\n");
         //for (int i = 0; i < 1000000000; i++);
         asm volatile ("jalr ra, %0" : : "r" (SET(0, l1->monitored[i])));
-        res = rdtime() - start;
+        res = bench_timestamp() - start;
         results[i] = res > UINT16_MAX ? UINT16_MAX : res;
     }
     //printf("l1i_probe: done\n");
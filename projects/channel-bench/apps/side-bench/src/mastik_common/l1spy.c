@@ -0,0 +1,93 @@
+/*The L1 data cache (and L2) covert channel: the trojan touches the
+  lines of secret sets, the spy primes and probes every set*/
+
+#include <autoconf.h>
+#include <manager/gen_config.h>
+#include <side-bench/gen_config.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sel4/sel4.h>
+#include <channel-bench/bench_common.h>
+#include <channel-bench/bench_types.h>
+#include <channel-bench/bench_helper.h>
+#include "low.h"
+#include "l1.h"
+#include "channel.h"
+
+struct l1_channel {
+    bench_cache_level_t *c;
+    char *data;           /*trojan*/
+    l1info_t l1;          /*spy*/
+    uint16_t *results;
+};
+
+static void *l1_channel_prepare(bench_args_t *args, bool spy) {
+
+    struct l1_channel *s = malloc(sizeof (struct l1_channel));
+    uint64_t monitored_mask[MONITOR_MASK];
+
+    assert(s);
+    s->c = geometry_prime_level(args->test_num);
+
+    if (!spy) {
+        /*a buffer covering every line of the probed level*/
+        s->data = malloc(cache_probe_buffer(s->c));
+        assert(s->data);
+        s->data = (char *)ALIGN_PAGE_SIZE(s->data);
+        return s;
+    }
+
+    for (int m = 0; m < MONITOR_MASK; m++)
+        monitored_mask[m] = ~0LLU;
+
+    s->l1 = l1_prepare(s->c, monitored_mask);
+    s->results = malloc(l1_nsets(s->l1) * sizeof (uint16_t));
+    assert(s->results);
+    return s;
+}
+
+static uint32_t l1_channel_secret(void *state) {
+
+    struct l1_channel *s = state;
+
+    return random() % (s->c->sets + 1);
+}
+
+static void l1_channel_encode(void *state, uint32_t secret) {
+
+    struct l1_channel *s = state;
+
+    l1d_data_access(s->c, s->data, secret);
+}
+
+/*the total cost of probing every set*/
+static uint32_t l1_channel_probe(void *state) {
+
+    struct l1_channel *s = state;
+    uint32_t total = 0;
+
+    l1_probe(s->l1, s->results);
+
+    for (int j = 0; j < l1_nsets(s->l1); j++)
+        total += s->results[j];
+    return total;
+}
+
+static const channel_t l1_channel = {
+    .prepare = l1_channel_prepare,
+    .secret = l1_channel_secret,
+    .encode = l1_channel_encode,
+    .probe = l1_channel_probe,
+};
+
+int l1_trojan(bench_env_t *env) {
+
+    return channel_trojan(env, &l1_channel);
+}
+
+int l1_spy(bench_env_t *env) {
+
+    return channel_spy(env, &l1_channel);
+}
@@ -6,6 +6,7 @@
 #include <channel-bench/bench_helper.h>
 #include <channel-bench/bench_types.h>
 #include "vlist.h"
+#include "geometry.h"
 
 #ifdef CONFIG_ARCH_ARM 
 #include "../mastik_arm/l3_arm.h"
@@ -30,7 +31,13 @@
 
 #define WARMUP_ROUNDS 0x1000 
 
-/*the cache architecture configuration on benchmarking platforms*/
+/*the cycle counter read around the probe kernels*/
+static inline uint32_t probe_time(void) {
+    return bench_timestamp();
+}
+
+/*the cache architecture configuration on benchmarking platforms, the
+ default for the geometry filled at run time in geometry.c*/
 #ifdef CONFIG_ARCH_X86
 
 #define L1_ASSOCIATIVITY   8
@@ -54,50 +61,7 @@
 #define L2_PROBE_BUFFER    (PAGE_SIZE + (L2_STRIDE * L2_ASSOCIATIVITY))  
 
 
-#if defined (CONFIG_BENCH_COVERT_L2) || defined (CONFIG_BENCH_CACHE_FLUSH_L2_CACHES)
-/*the L2 probing function shares with L1*/
-#undef L1_ASSOCIATIVITY   
-#define L1_ASSOCIATIVITY   L2_ASSOCIATIVITY
-
-#undef L1_SETS            
-#define L1_SETS            L2_SETS
-
-#undef L1_CACHELINE       
-#define L1_CACHELINE       L2_CACHELINE 
-
-#undef  L1_LINES           
-#define L1_LINES           L2_LINES 
-
-#undef L1_STRIDE   
-#define L1_STRIDE           L2_STRIDE 
-
-#undef L1_PROBE_BUFFER
-#define L1_PROBE_BUFFER    L2_PROBE_BUFFER
-
-#endif /*CONFIG_BENCH_COVERT_L2*/
-
-#ifdef CONFIG_BENCH_COVERT_L2_KERNEL_SCHEDULE 
-
-/*the L2 probing function shares with L1*/
-#undef L1_ASSOCIATIVITY   
-#define L1_ASSOCIATIVITY   L2_ASSOCIATIVITY
-
-#undef L1_SETS            
-#define L1_SETS            L2_SETS
-
-#undef L1_CACHELINE       
-#define L1_CACHELINE       L2_CACHELINE 
-
-#undef  L1_LINES           
-#define L1_LINES           L2_LINES 
-
-#undef L1_STRIDE   
-#define L1_STRIDE           L2_STRIDE 
-
-#undef L1_PROBE_BUFFER
-#define L1_PROBE_BUFFER    L2_PROBE_BUFFER
-
-#endif /*CONFIG_BENCH_COVERT_L2_KERNEL_SCHEDULE*/
+/*the L2 is probed with the L1 code, see geometry_prime_level()*/
 
 
 
@@ -574,7 +538,7 @@ static inline vlist_t search(cachemap_t cm, enum timing_api api_no,
           find one that do not have conflict with the test code
           but have conflict with the seL4 Poll service*/
         for (int p  = 0; p < cm->nsets; p++) {
-            pp_t pp = pp_prepare(cm->sets[p] , L3_ASSOCIATIVITY, line);
+            pp_t pp = pp_prepare(cm->sets[p] , geometry.l3.associativity, line);
             int t = scan(pp, api_no, caps);
             if (t) {
                 /*record target probing set*/
@@ -672,7 +636,7 @@ struct cacheInfo {
   uint32_t      reserved2:29;
 };
 
-inline void cpuid(struct cpuidRegs *regs) {
+static inline void cpuid(struct cpuidRegs *regs) {
   asm volatile ("cpuid": "+a" (regs->eax), "+b" (regs->ebx), "+c" (regs->ecx), "+d" (regs->edx));
 }
 #endif /* CONFIG_ARCH_X86 */
@@ -716,9 +680,9 @@ static inline void fence() {
 static inline void  newTimeSlice(void){
   asm("");
   uint32_t best = 0;
-  uint32_t volatile  prev = rdtime();
+  uint32_t volatile  prev = bench_timestamp();
   for (;;) {
-    uint32_t volatile cur = rdtime();
+    uint32_t volatile cur = bench_timestamp();
     /*if (cur - prev > best) {
       best = cur - prev;
       //printf("best = %d\n", best);
@@ -732,9 +696,9 @@ static inline void  newTimeSlice(void){
 /*return when a big jump of the time stamp counter is detected*/
 static inline void  newTimeTick(void){
   asm("");
-  uint32_t volatile  prev = rdtime();
+  uint32_t volatile  prev = bench_timestamp();
   for (;;) {
-    uint32_t volatile cur = rdtime();
+    uint32_t volatile cur = bench_timestamp();
     if (cur - prev > 100)
       return;
     prev = cur;
@@ -797,7 +761,7 @@ static inline vlist_t search(cachemap_t cm, enum timing_api api_no,
           find one that do not have conflict with the test code
           but have conflict with the seL4 Poll service*/
         for (int p  = 0; p < cm->nsets; p++) {
-            pp_t pp = pp_prepare(cm->sets[p] , L3_ASSOCIATIVITY, line);
+            pp_t pp = pp_prepare(cm->sets[p] , geometry.l3.associativity, line);
             int t = scan(pp, api_no, caps);
             if (t) {
                 /*record target probing set*/
@@ -845,15 +809,15 @@ static inline void walk(void *p, int count) {
 
 #endif /* CONFIG_ARCH_RISCV */
 
-/*accessing N number of L1 D cache sets*/
-static inline void l1d_data_access(char *buf, uint32_t sets) {
+/*accessing N number of cache sets on a level*/
+static inline void l1d_data_access(bench_cache_level_t *c, char *buf, uint32_t sets) {
 
     /*sets == 0 return*/
 
     for (int s = 0; s < sets; s++) {
-        for (int i = 0; i < L1_ASSOCIATIVITY; i++) {
+        for (int i = 0; i < c->associativity; i++) {
 
-            low_access(buf + s * L1_CACHELINE + i * L1_STRIDE);
+            low_access(buf + s * c->line + i * c->sets * c->line);
         }
     }
 }
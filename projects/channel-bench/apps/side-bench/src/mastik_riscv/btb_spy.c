@@ -4,6 +4,7 @@
 #include <sel4/sel4.h>
 
 #include "../mastik_common/low.h"
+#include "../mastik_common/channel.h"
 #include <channel-bench/bench_common.h>
 #include <channel-bench/bench_types.h>
 
@@ -45,76 +46,34 @@ int btb_jmp(bool spy, uint32_t s) {
     return((int)result);
 }
 
-int btb_trojan(bench_env_t *env) {
-
-  uint32_t secret;
-  seL4_MessageInfo_t info;
-  bench_args_t *args = env->args;
-
-  /*receive the shared address to record the secret*/
-  volatile uint32_t *share_vaddr = (uint32_t *)args->shared_vaddr; 
+/*trojan: 0 - BTB_ENTRIES*/
+static uint32_t btb_secret(void *state) {
 
-  info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-  seL4_SetMR(0, 0); 
-  seL4_Send(args->r_ep, info);
+  return random() % (CONFIG_BENCH_BTB_ENTRIES + 1); 
+}
 
-  /*ready to do the test*/
-  seL4_Send(args->ep, info);
+static void btb_encode(void *state, uint32_t secret) {
 
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
-      if (i % 1000 == 0 || (i - 1) % 1000 == 0 || i == (CONFIG_BENCH_DATA_POINTS - 1)) printf("TROJAN: Data point %d\n", i);
+  btb_jmp(0, secret);
+}
 
-      /*waiting for a system tick*/
-      newTimeSlice();
+static uint32_t btb_probe_spy(void *state) {
 
-      /*trojan: 0 - BTB_ENTRIES*/
-      secret = random() % (CONFIG_BENCH_BTB_ENTRIES + 1); 
+  return btb_jmp(1, CONFIG_BENCH_BTB_ENTRIES);
+}
 
-      /*do the probe*/
-      btb_jmp(0, secret);
+static const channel_t btb_channel = {
+  .secret = btb_secret,
+  .encode = btb_encode,
+  .probe = btb_probe_spy,
+};
 
-      /*update the secret read by low*/ 
-      *share_vaddr = secret; 
-  }
-  while (1);
+int btb_trojan(bench_env_t *env) {
 
-  return 0;
+  return channel_trojan(env, &btb_channel);
 }
 
-
 int btb_spy(bench_env_t *env) {
-  seL4_Word badge;
-  seL4_MessageInfo_t info;
-  uint32_t start; 
-  bench_args_t *args = env->args; 
-
-  /*the record address*/
-  struct bench_l1 *r_addr = (struct bench_l1 *)args->record_vaddr; 
-  /*the shared address*/
-  volatile uint32_t *secret = (uint32_t*)args->shared_vaddr; 
-
-  /*syn with trojan*/
-  info = seL4_Recv(args->ep, &badge);
-  assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
-
-
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
-    if (i % 1000 == 0 || (i - 1) % 1000 == 0 || i == (CONFIG_BENCH_DATA_POINTS - 1)) printf("SPY: Data point %d\n", i);
-
-      newTimeSlice();
-
-      r_addr->result[i] = btb_jmp(1, CONFIG_BENCH_BTB_ENTRIES);
-      r_addr->sec[i] = *secret; 
-
-  }
-
-  /*send result to manager, spy is done*/
-  info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-  seL4_SetMR(0, 0);
-  seL4_Send(args->r_ep, info);
-
-  while (1);
-
 
-  return 0;
+  return channel_spy(env, &btb_channel);
 }
@@ -36,8 +36,8 @@ int l1i_trojan(bench_env_t *env) {
   /*ready to do the test*/
   seL4_Send(args->ep, info);
 
-for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
-      if (i % 1000 == 0 || (i - 1) % 1000 == 0 || i == (CONFIG_BENCH_DATA_POINTS - 1)) printf("TROJAN: Data point %d\n", i);
+for (int i = 0; i < env->args->data_points; i++) {
+      if (i % 1000 == 0 || (i - 1) % 1000 == 0 || i == (env->args->data_points - 1)) printf("TROJAN: Data point %d\n", i);
       
       /*waiting for a system tick*/
       newTimeSlice();
@@ -108,8 +108,8 @@ int l1i_spy(bench_env_t *env) {
   assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
 
 
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
-      if (i % 1000 == 0 || (i - 1) % 1000 == 0 || i == (CONFIG_BENCH_DATA_POINTS - 1)) printf("SPY: Data point %d\n", i);
+  for (int i = 0; i < env->args->data_points; i++) {
+      if (i % 1000 == 0 || (i - 1) % 1000 == 0 || i == (env->args->data_points - 1)) printf("SPY: Data point %d\n", i);
       newTimeSlice();
 #ifdef CONFIG_MANAGER_PMU_COUNTER
       pmu_start = sel4bench_get_counter(0);  
@@ -119,16 +119,17 @@ int l1i_spy(bench_env_t *env) {
 #ifdef CONFIG_MANAGER_PMU_COUNTER 
       /*loading the pmu counter value */
       pmu_end = sel4bench_get_counter(0);  
-      r_addr->pmu[i][0] = pmu_end - pmu_start; 
+      r_addr->pmu[BENCH_RECORD_SLOT(i)][0] = pmu_end - pmu_start; 
 
 #endif
       /*result is the total probing cost
         secret is updated by trojan in the previous system tick*/
-      r_addr->result[i] = 0; 
-      r_addr->sec[i] = *secret; 
+      r_addr->result[BENCH_RECORD_SLOT(i)] = 0; 
+      r_addr->sec[BENCH_RECORD_SLOT(i)] = *secret; 
       
       for (int j = 0; j < l1i_nsets(l1i_1); j++) 
-          r_addr->result[i] += results[j];
+          r_addr->result[BENCH_RECORD_SLOT(i)] += results[j];
+      bench_record_commit(r_addr, i);
 
 #ifdef CONFIG_BENCH_COVERT_L1I_REWRITE
       l1i_rewrite(l1i_1);
@@ -25,12 +25,12 @@ int l3_kd_spy(bench_env_t *env) {
     uint32_t prev_s = *secret; 
     
 
-    ccnt_t start = rdtime();
+    ccnt_t start = bench_timestamp();
 
     uint64_t prev = start;
     
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS;) {
-        ccnt_t cur = rdtime(); 
+    for (int i = 0; i < env->args->data_points;) {
+        ccnt_t cur = bench_timestamp(); 
         /*at the begining of the current tick*/
         if (cur - prev >= TS_THRESHOLD) {
             r_addr->prevs[i] = prev;
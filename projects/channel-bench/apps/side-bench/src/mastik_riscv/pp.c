@@ -40,9 +40,9 @@ int pp_probe(pp_t pp) {
   int rv = 0;
   void *p = (void *)pp;
   do {
-    uint32_t s = rdtime();
+    uint32_t s = bench_timestamp();
     p = LNEXT(p);
-    s = rdtime() - s;
+    s = bench_timestamp() - s;
     if (s > L3_THRESHOLD)
       rv++;
   } while (p != (void *) pp);
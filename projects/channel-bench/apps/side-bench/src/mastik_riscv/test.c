@@ -23,12 +23,12 @@ int a;
 void probe100(pp_t pp) {
   pp_prime(pp, 50);
   char out[1001];
-  uint32_t p = rdtime();
+  uint32_t p = bench_timestamp();
   for (int i = 0; i < 1000; i++) {
     out[i] = '0' + pp_probe(pp);
     do {
-    } while (rdtime() - p < 5000);
-    p = rdtime();
+    } while (bench_timestamp() - p < 5000);
+    p = bench_timestamp();
   }
   out[1000] = '\0';
   printf("%s\n", out);
@@ -64,7 +64,7 @@ int mastik_test(int ac, char **av) {
 
   pp_t *pps[256];
   for (int i = 0; i < cm->nsets; i++)
-    pps[i] = pp_prepare(cm->sets[i], L3_ASSOCIATIVITY, 256);
+    pps[i] = pp_prepare(cm->sets[i], geometry.l3.associativity, 256);
 
   printf("Done preparing\n");
 
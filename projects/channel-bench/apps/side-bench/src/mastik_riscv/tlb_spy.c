@@ -4,12 +4,13 @@
 #include <sel4/sel4.h>
 
 #include "../mastik_common/low.h"
+#include "../mastik_common/channel.h"
 #include <channel-bench/bench_common.h>
 #include <channel-bench/bench_types.h>
 
 
-#define SPY_TLB_PAGES TLB_PROBE_PAGES
-#define TROJAN_TLB_PAGES TLB_ENTRIES
+#define SPY_TLB_PAGES (geometry.tlb_probe_pages)
+#define TROJAN_TLB_PAGES (geometry.tlb_entries)
 
 
 static int32_t *buf;
@@ -39,101 +40,53 @@ static void allocbuf(int spy) {
 
 static volatile int a;
 uint32_t tlb_probe(int secret) {
-  uint32_t start = rdtime();
+  uint32_t start = probe_time();
   int i = 0;
 
   if (!secret)
-      return rdtime() - start; 
+      return probe_time() - start; 
   do {
     i = buf[i];
   } while ((i!=0) && (--secret > 0));
   a = i;
-  return rdtime() - start;
+  return probe_time() - start;
 }
 
 
-int tlb_trojan(bench_env_t *env) {
-
-
-  uint32_t secret;
-  seL4_MessageInfo_t info;
-  bench_args_t *args = env->args; 
-
-  allocbuf(0);
-
-  volatile uint32_t *share_vaddr = (uint32_t *)args->shared_vaddr;
-  
-  info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-  seL4_SetMR(0, 0); 
-  seL4_Send(args->r_ep, info);
-
- /*ready to do the test*/
-  seL4_Send(args->ep, info);
+static void *tlb_prepare(bench_args_t *args, bool spy) {
 
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
-      if (i % 1000 == 0 || (i - 1) % 1000 == 0 || i == (CONFIG_BENCH_DATA_POINTS - 1)) printf("TROJAN: Data point %d\n", i);
-
-      newTimeSlice();
-      secret = random() % (TROJAN_TLB_PAGES+1);
-
-      tlb_probe(secret);
-      /*update the secret read by low*/ 
-      *share_vaddr = secret; 
-
-  }
-  while (1);
- 
-  return 0;
+  allocbuf(spy);
+  return NULL;
 }
 
-int tlb_spy(bench_env_t *env) {
-  seL4_Word badge;
-  seL4_MessageInfo_t info;
-  bench_args_t *args = env->args; 
-
-  uint64_t volatile UNUSED pmu_start; 
-  uint64_t volatile UNUSED pmu_end; 
-
-
-  allocbuf(1);
-  
-  struct bench_l1 *r_addr = (struct bench_l1 *)args->record_vaddr;
-  /*the shared address*/
-  volatile uint32_t *secret = (uint32_t*)args->shared_vaddr;
-
-  /*syn with trojan*/
-  info = seL4_Recv(args->ep, &badge);
-  assert(seL4_MessageInfo_get_label(info) == seL4_Fault_NullFault);
+static uint32_t tlb_secret(void *state) {
 
+  return random() % (TROJAN_TLB_PAGES+1);
+}
 
-  for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
-      if (i % 1000 == 0 || (i - 1) % 1000 == 0 || i == (CONFIG_BENCH_DATA_POINTS - 1)) printf("SPY: Data point %d\n", i);
+static void tlb_encode(void *state, uint32_t secret) {
 
-      newTimeSlice();
-#ifdef CONFIG_MANAGER_PMU_COUNTER
-      pmu_start = sel4bench_get_counter(0);  
-#endif 
+  tlb_probe(secret);
+}
 
-      /*result is the total probing cost
-        secret is updated by trojan in the previous system tick*/
-      r_addr->result[i] = tlb_probe(SPY_TLB_PAGES);
-      r_addr->sec[i] = *secret; 
+static uint32_t tlb_probe_spy(void *state) {
 
-#ifdef CONFIG_MANAGER_PMU_COUNTER 
-      /*loading the pmu counter value */
-      pmu_end = sel4bench_get_counter(0);  
-      r_addr->pmu[i][0] = pmu_end - pmu_start; 
+  return tlb_probe(SPY_TLB_PAGES);
+}
 
-#endif
-  }
+static const channel_t tlb_channel = {
+  .prepare = tlb_prepare,
+  .secret = tlb_secret,
+  .encode = tlb_encode,
+  .probe = tlb_probe_spy,
+};
 
-  /*send result to manager, spy is done*/
-  info = seL4_MessageInfo_new(seL4_Fault_NullFault, 0, 0, 1);
-  seL4_SetMR(0, 0);
-  seL4_Send(args->r_ep, info);
+int tlb_trojan(bench_env_t *env) {
 
-  while (1);
+  return channel_trojan(env, &tlb_channel);
+}
 
+int tlb_spy(bench_env_t *env) {
 
-  return 0;
+  return channel_spy(env, &tlb_channel);
 }
@@ -9,15 +9,15 @@ int mastik_victim(int ac, char **av) {
   p &= ~(0xfff); 
   p += 0x1000; 
   p += 256;
-  uint32_t t = rdtime();
+  uint32_t t = bench_timestamp();
   for (;;) {
     do {
       low_access((void*)p);
-    } while (rdtime() - t < 50000);
-    t = rdtime();
+    } while (bench_timestamp() - t < 50000);
+    t = bench_timestamp();
     do {
-    } while (rdtime() - t < 50000);
-    t = rdtime();
+    } while (bench_timestamp() - t < 50000);
+    t = bench_timestamp();
   }
 }
 
@@ -64,7 +64,7 @@ int timer_high(bench_env_t *env) {
     *share_vaddr = secret; 
 
    
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS; i++) {
+    for (int i = 0; i < env->args->data_points; i++) {
         
         /*waiting for a system tick*/
         newTimeSlice();
@@ -119,7 +119,7 @@ int timer_low(bench_env_t *env) {
 #ifdef CONFIG_ARCH_ARM
     SEL4BENCH_READ_CCNT(start);  
 #elif defined CONFIG_ARCH_RISCV
-    start = rdtime();
+    start = rdcycle();
 #else
 
     start = rdtscp_64(); 
@@ -128,13 +128,13 @@ int timer_low(bench_env_t *env) {
     prev = start;
 
     uint32_t volatile prev_s = *secret; 
-    for (int i = 0; i < CONFIG_BENCH_DATA_POINTS;) {
+    for (int i = 0; i < env->args->data_points;) {
         FENCE(); 
 
 #ifdef CONFIG_ARCH_ARM
         SEL4BENCH_READ_CCNT(cur);  
 #elif defined CONFIG_ARCH_RISCV
-        cur = rdtime();
+        cur = rdcycle();
 #else        
         cur = rdtscp_64();
 #endif 
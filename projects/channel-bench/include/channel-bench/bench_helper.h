@@ -122,15 +122,76 @@ static inline uint32_t rdtscp() {
 
 #ifdef CONFIG_ARCH_RISCV
 
-static inline uint32_t rdtime() {
+/*the core cycle counter*/
+static inline uint32_t rdcycle() {
   uint32_t rv;
   asm volatile ("rdcycle %0": "=r" (rv) ::);
   return rv;
 }
 
-static inline uint32_t rdtscp() { return rdtime(); }
+/*the platform timer, ticking much slower than the core*/
+static inline uint32_t rdtime() {
+  uint32_t rv;
+  asm volatile ("rdtime %0": "=r" (rv) ::);
+  return rv;
+}
+
+static inline uint32_t rdtscp() { return rdcycle(); }
 #endif /* CONFIG_ARCH_RISCV */
 
+/*the timestamp of the benchmarks: the core cycle counter. rdtscp waits
+  for the instructions before it on x86, the RISC-V and ARM cores we run
+  on do not read the counter ahead of the loads before it*/
+static inline uint32_t bench_timestamp(void) {
+#if defined CONFIG_ARCH_X86
+    return rdtscp();
+#elif defined CONFIG_ARCH_RISCV
+    return rdcycle();
+#else
+    uint32_t t;
+
+    SEL4BENCH_READ_CCNT(t);
+    return t;
+#endif
+}
+
+/*the cost of reading the timestamp, back to back, and the smallest step
+  it is seen to take. on RISC-V, also the cycles in a tick of the
+  platform timer, unless timer_tick is NULL*/
+static inline void bench_timestamp_calibrate(uint32_t *overhead, uint32_t *resolution,
+        uint32_t UNUSED *timer_tick) {
+
+    uint32_t start, end;
+
+    *overhead = *resolution = UINT32_MAX;
+
+    for (int i = 0; i < BENCH_WARMUPS; i++) {
+        start = bench_timestamp();
+        end = bench_timestamp();
+        if (end - start < *overhead)
+            *overhead = end - start;
+
+        /*spin until the timestamp moves*/
+        start = bench_timestamp();
+        while ((end = bench_timestamp()) == start);
+        if (end - start < *resolution)
+            *resolution = end - start;
+    }
+
+#ifdef CONFIG_ARCH_RISCV
+    if (!timer_tick)
+        return;
+
+    uint32_t tick = rdtime();
+
+    while (rdtime() == tick);
+    tick = rdtime();
+    start = rdcycle();
+    while (rdtime() - tick < BENCH_WARMUPS);
+    *timer_tick = (rdcycle() - start) / BENCH_WARMUPS;
+#endif
+}
+
 static inline int wait_init_msg_from(seL4_CPtr endpoint) {
 
     seL4_Word badge; 
@@ -23,16 +23,42 @@
 #include <sel4bench/sel4bench.h>
 #include "bench_common.h"
 
+#ifdef CONFIG_MANAGER_RECORD_RING
+/*the spy streams its records through a ring of this many slots, 
+ drained by the manager while the spy runs*/
+#define BENCH_RING_SLOTS        0x1000
+#define BENCH_L1_RECORDS        BENCH_RING_SLOTS
+#define BENCH_RECORD_SLOT(i)    ((i) & (BENCH_RING_SLOTS - 1))
+#else 
+#define BENCH_L1_RECORDS        CONFIG_BENCH_DATA_POINTS
+#define BENCH_RECORD_SLOT(i)    (i)
+#endif 
+
 struct bench_l1 {
+#ifdef CONFIG_MANAGER_RECORD_RING
+    /*number of records published by the spy, the only shared 
+     state written by it, on a cache line of its own*/
+    volatile uint32_t head; 
+    char pad[CL_SIZE - sizeof (uint32_t)];
+#endif 
     /*L1 data/instruction cache 64 sets, the result contains the 
      total cost on probing L1 D/I cache*/
-    uint32_t result[CONFIG_BENCH_DATA_POINTS];
-    uint32_t sec[CONFIG_BENCH_DATA_POINTS];
+    uint32_t result[BENCH_L1_RECORDS];
+    uint32_t sec[BENCH_L1_RECORDS];
 #ifdef CONFIG_MANAGER_PMU_COUNTER 
-    uint32_t pmu[CONFIG_BENCH_DATA_POINTS][BENCH_PMU_COUNTERS]; 
+    uint32_t pmu[BENCH_L1_RECORDS][BENCH_PMU_COUNTERS]; 
 #endif 
 };
 
+/*publish record i, written to slot BENCH_RECORD_SLOT(i). 
+ The spy never waits for the manager: a slot the manager has not 
+ read yet is overwritten, and the manager counts it as lost*/
+static inline void bench_record_commit(struct bench_l1 *r, int i) {
+#ifdef CONFIG_MANAGER_RECORD_RING
+    __atomic_store_n(&r->head, i + 1, __ATOMIC_RELEASE);
+#endif 
+}
+
 struct bench_kernel_schedule {
     ccnt_t prevs[CONFIG_BENCH_DATA_POINTS];
     ccnt_t starts[CONFIG_BENCH_DATA_POINTS];
@@ -73,12 +99,32 @@ typedef struct {
 
 } kernel_timing_caps_t; 
 
+/*the probe buffer of the LLC kernel channel, and the probe sets found in it*/
+#define BENCH_PROBE_BUFFER_SIZE   (16 * 1024 * 1024)
+#define BENCH_PROBE_SETS_MAX      64
+#define BENCH_PROBE_SET_LINES     32
+
+/*a probe set: the lines at offset in each of the pages*/
+typedef struct {
+    uint16_t api;        /*enum timing_api*/
+    uint16_t offset;     /*within the page*/
+    uint16_t lines;  
+    uint16_t page[BENCH_PROBE_SET_LINES];   /*index into the probe buffer*/
+} bench_probe_set_t; 
+
+typedef struct {
+    uint32_t n; 
+    uint32_t verified;  /*sets given that still probe the kernel*/
+    bench_probe_set_t set[BENCH_PROBE_SETS_MAX];
+} bench_probe_sets_t; 
+
 typedef struct  {
     
     uint32_t probe_results[CONFIG_BENCH_DATA_POINTS][timing_api_num];
     uint32_t probe_sets[timing_api_num];
     enum timing_api probe_seq[CONFIG_BENCH_DATA_POINTS]; 
-
+    /*in: sets found by an earlier run, out: the sets probed*/
+    bench_probe_sets_t saved; 
 
 } bench_llc_kernel_probe_result_t; 
 
@@ -131,10 +177,29 @@ typedef struct {
 }splash_bench_result_t ; 
 
 
+/*geometry of a cache level, 0 if not known*/
+typedef struct {
+    uint32_t associativity; 
+    uint32_t sets; 
+    uint32_t line;   /*line size in bytes*/
+} bench_cache_level_t; 
+
+/*cache and translation buffer geometry of the benchmarking platform
+ fields left 0 are discovered or defaulted by the benchmarking thread*/
+typedef struct {
+    bench_cache_level_t l1d; 
+    bench_cache_level_t l2; 
+    bench_cache_level_t l3; 
+    uint32_t tlb_entries; 
+    uint32_t tlb_probe_pages;  /*pages probed by the tlb spy*/
+    uint32_t btac_entries; 
+} bench_geometry_t; 
+
 /*the argument passes to the benchmarking thread*/
 typedef struct {
 
     int test_num; 
+    int data_points; /*data points to record, at most CONFIG_BENCH_DATA_POINTS*/
 
     uintptr_t shared_vaddr; /*pages shared between benchmarking thread*/ 
     size_t shared_pages;
@@ -151,6 +216,9 @@ typedef struct {
     uintptr_t morecore_vaddr;  /*the morecore area for over writing the default*/
     size_t morecore_size; 
 
+    uintptr_t probe_vaddr;  /*probe buffer at a fixed physical address, or 0*/
+    size_t probe_size; 
+
     seL4_CPtr ep;   /*communicate between benchmarking threads(spy&trojan)*/
     seL4_CPtr r_ep;  /*reply to root task*/
     seL4_CPtr notification_ep; /*notification ep used only within a domain*/ 
@@ -164,6 +232,8 @@ typedef struct {
     /*the flag of an equiped timer*/
     bool timer_enabled; 
     bool untype_none;  /*the flag of not allocating the untypes, only used by idle thread*/
+    /*cache geometry described by the root task*/
+    bench_geometry_t geometry; 
 
 } bench_args_t;
 
@@ -0,0 +1,456 @@
+/* batch.c
+
+   Run a batch of capacity calculations, as listed in a manifest, in a single
+   process.  Each job filters a sample set, optionally partitions it, builds
+   the channel matrix, finds its capacity and, optionally, simulates the
+   same number of samples from a uniform channel with no bandwidth, to give
+   a simple noise floor.  This replaces chaining filter_samples,
+   channel_matrix and capacity through temporary files: every dataset is
+   parsed once, the log table is built once, and nothing is written but the
+   results.  A dataset is read when the first job using it starts, and freed
+   when the last finishes.
+
+   This code is experimental, and error-handling is primitive.
+*/
+
+/* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
+
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "channel_algorithms.h"
+#include "log.h"
+#include "samples.h"
+#include "sampling.h"
+#include "sparse.h"
+
+/* A sample set, read in full while any job needs it. */
+struct dataset {
+    char *name;
+    smp_t *s;
+    size_t n;
+
+    pthread_mutex_t lock;
+    int loaded;
+    int users;              /* Jobs yet to finish with it. */
+};
+
+/* A single line of the manifest, and its results. */
+struct job {
+    int line;
+    int set;
+    struct dataset *D;
+    int in_min, in_max;     /* Filter: the inputs (rows) to keep... */
+    int out_min, out_max;   /* ...and the outputs (columns). */
+    int limit, discard;     /* Partition: per input, skip 'discard' samples
+                               then take at most 'limit' (-1 for all). */
+    float epsilon;
+    int runs;               /* Noise-floor simulations (0 for none). */
+
+    /* Results. */
+    uint64_t used;          /* Samples in the matrix. */
+    int rows, cols;
+    float cap, e;
+    float noise_mean, noise_max;
+    int done;
+};
+
+/* The jobs are handed out in order.  Results are printed in manifest order,
+ * as soon as all earlier jobs have finished. */
+struct batch {
+    struct job *jobs;
+    int njobs;
+    uint32_t seed;
+    FILE *out;
+
+    pthread_mutex_t lock;
+    int next_job;
+    int next_out;
+};
+
+/* Read a whole sample set.  "-" is stdin. */
+static void
+dataset_load(struct dataset *D) {
+    smp_reader_t *R;
+    const smp_t *batch;
+    size_t n, size= 0;
+    FILE *f;
+
+    if(!strcmp(D->name, "-")) f= stdin;
+    else {
+        f= fopen(D->name, "rb");
+        if(!f) { perror(D->name); exit(EXIT_FAILURE); }
+    }
+
+    D->s= NULL;
+    D->n= 0;
+
+    R= smp_reader_new(f);
+    while((n= smp_read(R, &batch)) > 0) {
+        if(D->n + n > size) {
+            size= size ? 2 * size : (1 << 20);
+            if(size < D->n + n) size= D->n + n;
+            D->s= realloc(D->s, size * sizeof(smp_t));
+            if(!D->s) { perror("realloc"); abort(); }
+        }
+        memcpy(D->s + D->n, batch, n * sizeof(smp_t));
+        D->n+= n;
+    }
+    if(R->malformed > 0)
+        fprintf(stderr, "%s: %lu malformed lines\n", D->name,
+                (unsigned long)R->malformed);
+    smp_reader_destroy(R);
+
+    if(f != stdin) fclose(f);
+
+    fprintf(stderr, "Read %s: %lu samples.\n", D->name, (unsigned long)D->n);
+}
+
+/* Load a dataset, unless another job already has. */
+static void
+dataset_get(struct dataset *D) {
+    pthread_mutex_lock(&D->lock);
+    if(!D->loaded) {
+        dataset_load(D);
+        D->loaded= 1;
+    }
+    pthread_mutex_unlock(&D->lock);
+}
+
+/* Free a dataset once its last job is done with it. */
+static void
+dataset_put(struct dataset *D) {
+    pthread_mutex_lock(&D->lock);
+    assert(D->users > 0);
+    if(--D->users == 0) {
+        free(D->s);
+        D->s= NULL;
+        D->n= 0;
+    }
+    pthread_mutex_unlock(&D->lock);
+}
+
+/* Parse a range bound, "-" being unbounded. */
+static int
+parse_bound(const char *s, int unbounded, int line) {
+    char *end;
+    long v;
+
+    if(!strcmp(s, "-")) return unbounded;
+
+    v= strtol(s, &end, 0);
+    if(*end || v < INT_MIN || v > INT_MAX) {
+        fprintf(stderr, "Line %d: bad value %s\n", line, s);
+        exit(EXIT_FAILURE);
+    }
+    return (int)v;
+}
+
+/* Read the manifest, sharing datasets between the jobs that name them. */
+static void
+read_manifest(FILE *f, struct job **jobs, int *njobs,
+              struct dataset **sets, int *nsets) {
+    char buf[4096];
+    int line= 0;
+
+    *jobs= NULL; *njobs= 0;
+    *sets= NULL; *nsets= 0;
+
+    while(fgets(buf, sizeof(buf), f)) {
+        char *tok[9], *p;
+        int ntok= 0, i;
+        struct job *J;
+
+        line++;
+
+        for(p= strtok(buf, " \t\r\n"); p && ntok < 9;
+            p= strtok(NULL, " \t\r\n"))
+            tok[ntok++]= p;
+        if(ntok == 0 || tok[0][0] == '#') continue;
+        if(ntok < 8) {
+            fprintf(stderr, "Line %d: expected at least 8 fields\n", line);
+            exit(EXIT_FAILURE);
+        }
+
+        *jobs= realloc(*jobs, (*njobs + 1) * sizeof(struct job));
+        if(!*jobs) { perror("realloc"); abort(); }
+        J= &(*jobs)[(*njobs)++];
+        memset(J, 0, sizeof(struct job));
+
+        J->line= line;
+        J->in_min=  parse_bound(tok[1], INT_MIN, line);
+        J->in_max=  parse_bound(tok[2], INT_MAX, line);
+        J->out_min= parse_bound(tok[3], INT_MIN, line);
+        J->out_max= parse_bound(tok[4], INT_MAX, line);
+        J->limit=   parse_bound(tok[5], -1, line);
+        J->discard= parse_bound(tok[6], 0, line);
+        J->epsilon= strtof(tok[7], NULL);
+        J->runs=    ntok > 8 ? parse_bound(tok[8], 0, line) : 0;
+
+        if(J->epsilon <= 0.0) {
+            fprintf(stderr, "Line %d: bad precision %s\n", line, tok[7]);
+            exit(EXIT_FAILURE);
+        }
+        if(J->in_min > J->in_max || J->out_min > J->out_max) {
+            fprintf(stderr, "Line %d: empty range\n", line);
+            exit(EXIT_FAILURE);
+        }
+        if(J->limit >= 0 && (J->in_min == INT_MIN || J->in_max == INT_MAX)) {
+            fprintf(stderr, "Line %d: partitioning needs an input range\n",
+                    line);
+            exit(EXIT_FAILURE);
+        }
+
+        for(i= 0; i < *nsets && strcmp((*sets)[i].name, tok[0]); i++);
+        if(i == *nsets) {
+            *sets= realloc(*sets, (*nsets + 1) * sizeof(struct dataset));
+            if(!*sets) { perror("realloc"); abort(); }
+            memset(&(*sets)[i], 0, sizeof(struct dataset));
+            (*sets)[i].name= strdup(tok[0]);
+            if(!(*sets)[i].name) { perror("strdup"); abort(); }
+            pthread_mutex_init(&(*sets)[i].lock, NULL);
+            (*nsets)++;
+        }
+        (*sets)[i].users++;
+        J->set= i;
+    }
+
+    /* The dataset array may have moved, so link it up last. */
+    for(line= 0; line < *njobs; line++)
+        (*jobs)[line].D= &(*sets)[(*jobs)[line].set];
+}
+
+/* The RNG seed for simulation k of job j. */
+static uint32_t
+sim_seed(uint32_t seed, int j, int k) {
+    /* splitmix64, to decorrelate neighbouring simulations. */
+    uint64_t z= ((uint64_t)seed << 32) + ((uint64_t)j << 20) + (uint64_t)k
+              + 0x9e3779b97f4a7c15ULL;
+    z= (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z= (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (uint32_t)(z ^ (z >> 31));
+}
+
+/* Simulate the same number of samples from a channel whose every input
+ * gives the average output distribution of M, and record the mean and
+ * greatest capacity found.  This is a simplified noise floor: unlike
+ * sample_error, it doesn't resample the measured channel itself. */
+static void
+noise_floor(struct job *J, csc_mat_t *M, int rows, int samples,
+            uint32_t seed, int j) {
+    struct sampler *S;
+    struct alias *A;
+    dv_t *avg;
+    dsfmt_t rng;
+    double sum= 0.0;
+    int k;
+
+    avg= average_cols(M);
+    A= alias_new(avg);
+    S= sampler_new(rows, samples, M->ncol);
+
+    J->noise_max= 0.0;
+    for(k= 0; k < J->runs; k++) {
+        float I, e;
+
+        dsfmt_init_gen_rand(&rng, sim_seed(seed, j, k));
+        I= ba_phased(sampled_matrix(S, A, A, &rng), J->epsilon, &e);
+        sum+= I;
+        if(I > J->noise_max) J->noise_max= I;
+    }
+    J->noise_mean= sum / J->runs;
+
+    sampler_destroy(S);
+    alias_destroy(A);
+    dv_destroy(avg);
+}
+
+/* Filter, partition, build the matrix and find its capacity. */
+static void
+run_job(struct job *J, uint32_t seed, int j) {
+    struct dataset *D= J->D;
+    bsc_hist_t *H;
+    csc_mat_t *M;
+    int *counts= NULL;
+    size_t i;
+    int r;
+
+    dataset_get(D);
+
+    if(J->limit >= 0) {
+        counts= calloc((size_t)J->in_max - J->in_min + 1, sizeof(int));
+        if(!counts) { perror("calloc"); abort(); }
+    }
+
+    H= bsc_hist_new();
+    for(i= 0; i < D->n; i++) {
+        int in= D->s[i].in, out= D->s[i].out;
+
+        if(in < J->in_min || J->in_max < in ||
+           out < J->out_min || J->out_max < out)
+            continue;
+
+        if(counts) {
+            int k= in - J->in_min;
+
+            if(counts[k] >= J->limit + J->discard) continue;
+            counts[k]++;
+            if(counts[k] <= J->discard) continue;
+        }
+
+        bsc_hist_count(H, out, in, 1);
+        J->used++;
+    }
+    free(counts);
+    dataset_put(D);
+
+    J->cap= NAN;
+    J->e= NAN;
+    J->noise_mean= NAN;
+    J->noise_max= NAN;
+
+    if(J->used == 0) {
+        bsc_hist_destroy(H);
+        return;
+    }
+
+    /* The simulation draws the average number of samples for every
+     * input. */
+    for(r= 0; r < H->end_row; r++)
+        if(H->row_total[r] > 0) J->rows++;
+
+    M= bsc_normalise(H);
+    bsc_hist_destroy(H);
+    csc_prune_cols(M);
+    J->cols= M->ncol;
+
+    J->cap= ba_phased(M, J->epsilon, &J->e);
+
+    if(J->runs > 0)
+        noise_floor(J, M, J->rows, (J->used + J->rows / 2) / J->rows, seed, j);
+
+    csc_mat_destroy(M);
+}
+
+static void
+print_job(FILE *out, struct job *J) {
+    fprintf(out, "%d %s %lu %d %d %.12e %.12e %.12e %.12e\n",
+            J->line, J->D->name, (unsigned long)J->used, J->rows, J->cols,
+            J->cap, J->cap + J->e, J->noise_mean, J->noise_max);
+}
+
+static void *
+worker(void *arg) {
+    struct batch *B= (struct batch *)arg;
+
+    while(1) {
+        int j;
+
+        pthread_mutex_lock(&B->lock);
+        j= B->next_job++;
+        pthread_mutex_unlock(&B->lock);
+        if(j >= B->njobs) break;
+
+        run_job(&B->jobs[j], B->seed, j);
+
+        /* Print everything that's now in order. */
+        pthread_mutex_lock(&B->lock);
+        B->jobs[j].done= 1;
+        while(B->next_out < B->njobs && B->jobs[B->next_out].done) {
+            print_job(B->out, &B->jobs[B->next_out]);
+            B->next_out++;
+        }
+        fflush(B->out);
+        pthread_mutex_unlock(&B->lock);
+    }
+
+    return (void *)0;
+}
+
+int
+main(int argc, char *argv[]) {
+    struct batch B;
+    struct dataset *sets;
+    int nsets;
+    pthread_t *threads;
+    int nthreads= 0;
+    FILE *manifest;
+    int i;
+
+    B.seed= time(NULL);
+    B.out= stdout;
+
+    for(i= 1; i < argc && argv[i][0] == '-' && argv[i][1]; i++) {
+        if(!strcmp(argv[i], "-j") && i + 1 < argc)
+            nthreads= atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-s") && i + 1 < argc)
+            B.seed= strtoul(argv[++i], NULL, 0);
+        else break;
+    }
+    if(i != argc - 1 && i != argc - 2) {
+        fprintf(stderr, "Usage: %s [-j <threads>] [-s <seed>] <manifest> "
+                "[<results>]\n", argv[0]);
+        return 1;
+    }
+
+    manifest= fopen(argv[i], "r");
+    if(!manifest) { perror(argv[i]); return 1; }
+    read_manifest(manifest, &B.jobs, &B.njobs, &sets, &nsets);
+    fclose(manifest);
+
+    if(i + 1 < argc) {
+        B.out= fopen(argv[i+1], "w");
+        if(!B.out) { perror(argv[i+1]); return 1; }
+    }
+
+    write_log_table();
+
+    if(nthreads < 1) nthreads= sysconf(_SC_NPROCESSORS_ONLN);
+    if(nthreads < 1) nthreads= 1;
+    if(nthreads > B.njobs) nthreads= B.njobs > 0 ? B.njobs : 1;
+
+    fprintf(stderr, "Running %d jobs on %d threads (seed %u)...\n",
+            B.njobs, nthreads, B.seed);
+
+    fprintf(B.out, "# uniform_*: capacity of simulated uniform channels with "
+            "no bandwidth\n");
+    fprintf(B.out, "# line dataset samples rows cols capacity upper "
+            "uniform_mean uniform_max\n");
+
+    pthread_mutex_init(&B.lock, NULL);
+    B.next_job= 0;
+    B.next_out= 0;
+
+    threads= malloc(nthreads * sizeof(pthread_t));
+    if(!threads) { perror("malloc"); abort(); }
+    for(i= 0; i < nthreads; i++) {
+        if(pthread_create(&threads[i], NULL, worker, &B)) {
+            perror("pthread_create");
+            abort();
+        }
+    }
+    for(i= 0; i < nthreads; i++) pthread_join(threads[i], NULL);
+    free(threads);
+
+    assert(B.next_out == B.njobs);
+    pthread_mutex_destroy(&B.lock);
+
+    if(B.out != stdout) fclose(B.out);
+
+    for(i= 0; i < nsets; i++) {
+        assert(!sets[i].s);
+        pthread_mutex_destroy(&sets[i].lock);
+        free(sets[i].name);
+    }
+    free(sets);
+    free(B.jobs);
+
+    return 0;
+}
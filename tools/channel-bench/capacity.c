@@ -16,6 +16,102 @@
 #include "sparse.h"
 #include "log.h"
 
+/* Load a matrix, ready for the ABA. */
+static csc_mat_t *
+load_matrix(const char *name) {
+    csc_mat_t *Q;
+    csc_errno_t e;
+    FILE *in;
+
+    in= fopen(name, "rb");
+    if(!in) { perror("fopen"); exit(EXIT_FAILURE); }
+
+    Q= csc_map_binary(in, &e);
+    if(!Q) { csc_perror(e, "csc_map_binary"); exit(EXIT_FAILURE); }
+
+    fclose(in);
+
+    csc_prune_cols(Q);
+
+    return Q;
+}
+
+/* Find the capacities of a series of matrices, starting each from the
+ * input distribution that achieved the last.  With 'compare', each is also
+ * solved from the uniform distribution, to measure the iterations saved. */
+static int
+chain(char *names[], int n, float epsilon, int quiet, int compare) {
+    double *p= NULL;
+    int nrow= -1;
+    long total= 0, total_cold= 0;
+    int i;
+
+    write_log_table();
+
+    for(i= 0; i < n; i++) {
+        csc_mat_t *Q= load_matrix(names[i]);
+        float c, e_obs;
+        int iters, cold= 0;
+
+        /* We can only carry the distribution over between matrices with the
+         * same inputs. */
+        if(Q->nrow != nrow) {
+            int r;
+
+            if(p && !quiet)
+                printf("%s: %d rows, not %d, starting from uniform.\n",
+                       names[i], Q->nrow, nrow);
+
+            nrow= Q->nrow;
+            p= realloc(p, nrow * sizeof(double));
+            if(!p) { perror("realloc"); abort(); }
+            for(r= 0; r < nrow; r++) p[r]= 1.0 / nrow;
+        }
+
+        if(compare) {
+            double *u= malloc(nrow * sizeof(double));
+            float e_cold;
+            int r;
+
+            if(!u) { perror("malloc"); abort(); }
+            for(r= 0; r < nrow; r++) u[r]= 1.0 / nrow;
+            ba_phased_warm(Q, epsilon, &e_cold, u, &cold);
+            free(u);
+        }
+
+        c= ba_phased_warm(Q, epsilon, &e_obs, p, &iters);
+
+        total+= iters;
+        total_cold+= cold;
+
+        if(!quiet) {
+            printf("%s: capacity %e(+%e,-0) bits per usage, %d iterations",
+                   names[i], c, e_obs, iters);
+            if(compare) printf(" (%d from uniform, %d saved)", cold,
+                               cold - iters);
+            printf(".\n");
+        }
+        else {
+            printf("%.12e %.12e %d", c, c + e_obs, iters);
+            if(compare) printf(" %d", cold);
+            printf("\n");
+        }
+        fflush(stdout);
+
+        csc_mat_destroy(Q);
+    }
+
+    if(!quiet) {
+        printf("%ld iterations in total", total);
+        if(compare) printf(", %ld from uniform, %ld saved", total_cold,
+                           total_cold - total);
+        printf(".\n");
+    }
+
+    free(p);
+    return 0;
+}
+
 int
 main(int argc, char *argv[]) {
     csc_mat_t *Q;
@@ -27,9 +123,28 @@ main(int argc, char *argv[]) {
     struct timespec start, end;
 #endif
 
+    if(argc > 1 && !strcmp(argv[1], "-c")) {
+        int compare= 0, i;
+
+        for(i= 3; i < argc; i++) {
+            if(!strcmp(argv[i], "-q"))      quiet= 1;
+            else if(!strcmp(argv[i], "-v")) compare= 1;
+            else break;
+        }
+        if(argc < 3 || i == argc) {
+            fprintf(stderr, "Usage: %s -c <precision> [-q] [-v] "
+                    "<channel_matrix>...\n", argv[0]);
+            return 1;
+        }
+
+        return chain(argv + i, argc - i, strtof(argv[2], NULL), quiet,
+                     compare);
+    }
+
     if(argc < 3) {
-        fprintf(stderr, "Usage: %s <channel_matrix> <precision> [-q]\n",
-                argv[0]);
+        fprintf(stderr, "Usage: %s <channel_matrix> <precision> [-q]\n"
+                "       %s -c <precision> [-q] [-v] <channel_matrix>...\n",
+                argv[0], argv[0]);
         return 1;
     }
 
@@ -42,8 +157,8 @@ main(int argc, char *argv[]) {
     in= fopen(argv[1], "rb");
     if(!in) { perror("fopen"); return 1; }
 
-    Q= csc_load_binary(in, &e);
-    if(!Q) { csc_perror(e, "csc_load_binary"); return 1; }
+    Q= csc_map_binary(in, &e);
+    if(!Q) { csc_perror(e, "csc_map_binary"); return 1; }
 
     fclose(in);
     if(!quiet) printf(" done.\n");
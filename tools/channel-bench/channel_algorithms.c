@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "kernels.h"
 #include "log.h"
 #include "sparse.h"
 
@@ -159,7 +160,7 @@ float
 blahut_arimoto_precise(csc_mat_t *Q, float epsilon, float *e_obs) {
     double *p, *q, *c;
     double Il, Iu, e;
-    double Il_best, e_best= INFINITY;
+    double Il_best= 0, e_best= INFINITY;
     int i, col, row;
     double *logQ, *logq;
 
@@ -277,7 +278,7 @@ float
 blahut_arimoto_precise_squeezed(csc_mat_t *Q, float epsilon, float *e_obs) {
     double *p, *q, *z;
     double Il, Iu, e;
-    double Il_best, e_best= INFINITY;
+    double Il_best= 0, e_best= INFINITY;
     int i, col, row;
     double *logQ, *logq;
     double lambda;
@@ -416,7 +417,7 @@ float
 blahut_arimoto_ld_squeezed(csc_mat_t *Q, float epsilon, float *e_obs) {
     long double *p, *q, *z;
     long double Il, Iu, e;
-    long double Il_best, e_best= INFINITY;
+    long double Il_best= 0, e_best= INFINITY;
     int i, col, row;
     long double *logQ, *logq;
     long double lambda;
@@ -564,7 +565,7 @@ blahut_arimoto_ld_squeezed(csc_mat_t *Q, float epsilon, float *e_obs) {
 /* The fastest, single-precision phase. */
 float
 single_phase(csc_mat_t *Q, float epsilon, float *e_obs, float *p,
-        float lambda) {
+        float lambda, double *p_best, int *n_iter) {
     float *q, *z;
     float Il, Iu, e, e_last= *e_obs;
     float Il_best= 0.0, e_best= INFINITY;
@@ -610,10 +611,7 @@ single_phase(csc_mat_t *Q, float epsilon, float *e_obs, float *p,
         }
 
         /* Precalculate log(q). */
-        for(col= 0; col < Q->ncol; col++) {
-            if(q[col] == 0) limited= 1;
-            logq[col]= log2f(q[col]);
-        }
+        if(kern_log2_f(logq, q, Q->ncol) > 0) limited= 1;
         if(limited) {
             D("Reached precision limit\n");
             break;
@@ -635,23 +633,21 @@ single_phase(csc_mat_t *Q, float epsilon, float *e_obs, float *p,
         }
 
         /* Find the largest element of c.  This is Iu, as log is monotonic. */
-        Iu= -INFINITY;
-        for(col= 0; col < Q->nrow; col++) {
-            if(z[col] > Iu) Iu= z[col];
-        }
+        Iu= kern_max_f(z, Q->nrow);
 
         /* Update Il.  By taking out the largest element of c, the
          * rest are all less than 1. */
-        tmp= 0.0;
-        for(row= 0; row < Q->nrow; row++) {
-            tmp+= p[row] * exp2f(z[row] - Iu);
-        }
+        tmp= kern_exp2_dot_f(p, z, 1.0, -Iu, Q->nrow);
         Il= Iu + log2f(tmp);
 
         e= Iu - Il;
 
         if(e < e_best) {
             Il_best= Il; e_best= e;
+            /* Remember the distribution that achieved it. */
+            if(p_best) {
+                for(row= 0; row < Q->nrow; row++) p_best[row]= p[row];
+            }
         }
 
         D("Il= %.6e Iu= %.6e e= %.6e\n", Il, Iu, e);
@@ -673,13 +669,8 @@ single_phase(csc_mat_t *Q, float epsilon, float *e_obs, float *p,
         e_last= e;
 
         /* Scale the input probabilities. */
-        tmp= 0.0;
-        for(row= 0; row < Q->nrow; row++) {
-            p[row]*= exp2f(lambda * z[row]);
-            tmp+= p[row];
-        }
-        for(row= 0; row < Q->nrow; row++)
-            p[row]/= tmp;
+        tmp= kern_exp2_scale_f(p, z, lambda, Q->nrow);
+        kern_div_f(p, tmp, Q->nrow);
     } 
 
     free(logq);
@@ -688,13 +679,15 @@ single_phase(csc_mat_t *Q, float epsilon, float *e_obs, float *p,
     free(q);
 
     if(e_obs) *e_obs= e_best;
+    if(n_iter) *n_iter+= iterations;
     return Il_best;
 }
 
 /* The slower double-precision phase. */
 float
 double_phase(csc_mat_t *Q, float epsilon, float *e_obs, double *p,
-        float lambda, float Il_best_prev, float e_best_prev) {
+        float lambda, float Il_best_prev, float e_best_prev, double *p_best,
+        int *n_iter) {
     double *q, *z;
     double Il, Iu, e, e_last= INFINITY;
     double Il_best= Il_best_prev, e_best= e_best_prev;
@@ -740,10 +733,7 @@ double_phase(csc_mat_t *Q, float epsilon, float *e_obs, double *p,
         }
 
         /* Precalculate log(q). */
-        for(col= 0; col < Q->ncol; col++) {
-            if(q[col] == 0) limited= 1;
-            logq[col]= log2(q[col]);
-        }
+        if(kern_log2_d(logq, q, Q->ncol) > 0) limited= 1;
         if(limited) {
             D("2 Reached precision limit\n");
             break;
@@ -766,23 +756,21 @@ double_phase(csc_mat_t *Q, float epsilon, float *e_obs, double *p,
         }
 
         /* Find the largest element of c.  This is Iu, as log is monotonic. */
-        Iu= -INFINITY;
-        for(col= 0; col < Q->nrow; col++) {
-            if(z[col] > Iu) Iu= z[col];
-        }
+        Iu= kern_max_d(z, Q->nrow);
 
         /* Update Il.  By taking out the largest element of c, the
          * rest are all less than 1. */
-        tmp= 0.0;
-        for(row= 0; row < Q->nrow; row++) {
-            tmp+= p[row] * exp2(z[row] - Iu);
-        }
+        tmp= kern_exp2_dot_d(p, z, 1.0, -Iu, Q->nrow);
         Il= Iu + log2(tmp);
 
         e= Iu - Il;
 
         if(e < e_best) {
             Il_best= Il; e_best= e;
+            /* Remember the distribution that achieved it. */
+            if(p_best) {
+                for(row= 0; row < Q->nrow; row++) p_best[row]= p[row];
+            }
         }
 
         D("Il= %.6le Iu= %.6le e= %.6e\n", Il, Iu, e);
@@ -804,13 +792,10 @@ double_phase(csc_mat_t *Q, float epsilon, float *e_obs, double *p,
         e_last= e;
 
         /* Find the denominator of the probability scale equation. */
-        tmp= 0.0;
-        for(row= 0; row < Q->nrow; row++)
-            tmp+= p[row] * exp2(lambda * z[row]);
+        tmp= kern_exp2_dot_d(p, z, lambda, 0.0, Q->nrow);
 
         /* Scale the input probabilities. */
-        for(row= 0; row < Q->nrow; row++)
-            p[row]= p[row] * exp2(lambda * z[row]) / tmp;
+        kern_exp2_scale_d(p, z, lambda, tmp, Q->nrow);
     } 
 
     free(logq);
@@ -819,13 +804,15 @@ double_phase(csc_mat_t *Q, float epsilon, float *e_obs, double *p,
     free(q);
 
     if(e_obs) *e_obs= e_best;
+    if(n_iter) *n_iter+= iterations;
     return Il_best;
 }
 
 /* The slowest, long-double, phase. */
 float
 long_double_phase(csc_mat_t *Q, float epsilon, float *e_obs,
-        long double *p, float lambda, float Il_best_prev, float e_best_prev) {
+        long double *p, float lambda, float Il_best_prev, float e_best_prev,
+        double *p_best, int *n_iter) {
     long double *q, *z;
     long double Il, Iu, e, e_last= INFINITY;
     long double Il_best= Il_best_prev, e_best= e_best_prev;
@@ -914,6 +901,10 @@ long_double_phase(csc_mat_t *Q, float epsilon, float *e_obs,
 
         if(e < e_best) {
             Il_best= Il; e_best= e;
+            /* Remember the distribution that achieved it. */
+            if(p_best) {
+                for(row= 0; row < Q->nrow; row++) p_best[row]= p[row];
+            }
         }
 
         D("Il= %.6le Iu= %.6le e= %.6e\n", (double)Il, (double)Iu, (double)e);
@@ -950,12 +941,14 @@ long_double_phase(csc_mat_t *Q, float epsilon, float *e_obs,
     free(q);
 
     if(e_obs) *e_obs= e_best;
+    if(n_iter) *n_iter+= iterations;
     return Il_best;
 }
 
-/* The phased implementation. */
+/* The phased implementation, from a given starting point. */
 float
-ba_phased(csc_mat_t *Q, float epsilon, float *e_obs) {
+ba_phased_warm(csc_mat_t *Q, float epsilon, float *e_obs, double *p,
+        int *n_iter) {
     float *ps;
     double *pd;
     long double *pld;
@@ -964,6 +957,9 @@ ba_phased(csc_mat_t *Q, float epsilon, float *e_obs) {
     float e_phase= INFINITY, Il;
     int col, i;
 
+    assert(p);
+    if(n_iter) *n_iter= 0;
+
     ps= malloc(Q->nrow * sizeof(float));
     if(!ps) { perror("malloc"); abort(); }
 
@@ -993,11 +989,22 @@ ba_phased(csc_mat_t *Q, float epsilon, float *e_obs) {
     D("som= %.e\n", som);
     D("lambda= %.e\n", lambda);
 
-    /* Start with a uniform input distribution. */
-    for(i= 0; i < Q->nrow; i++) ps[i]= 1.0 / Q->nrow;
+    /* Start from the given distribution.  An input with zero probability
+     * can never recover, so bump any up, as between phases. */
+    {
+        double sum= 0.0;
+        for(i= 0; i < Q->nrow; i++) {
+            if((float)p[i] <= 0.0)
+                ps[i]= JIGGER / Q->nrow;
+            else
+                ps[i]= (float)p[i];
+            sum+= ps[i];
+        }
+        for(i= 0; i < Q->nrow; i++) ps[i]/= sum;
+    }
 
     /* Start with single precision. */
-    Il= single_phase(Q, epsilon, &e_phase, ps, lambda);
+    Il= single_phase(Q, epsilon, &e_phase, ps, lambda, p, n_iter);
 
     /* Terminate if we've already hit the target. */
     if(e_phase < epsilon) {
@@ -1024,7 +1031,8 @@ ba_phased(csc_mat_t *Q, float epsilon, float *e_obs) {
     free(ps);
 
     /* Continue in double precision. */
-    Il= double_phase(Q, epsilon, &e_phase, pd, lambda, Il, e_phase);
+    Il= double_phase(Q, epsilon, &e_phase, pd, lambda, Il, e_phase, p,
+            n_iter);
 
     /* Again, terminate if good enough. */
     if(e_phase < epsilon) {
@@ -1051,10 +1059,28 @@ ba_phased(csc_mat_t *Q, float epsilon, float *e_obs) {
 
     /* Our last shot is long double precision, which may be no better than
      * double, depending on platform, but is usually slow. */
-    Il= long_double_phase(Q, epsilon, &e_phase, pld, lambda, Il, e_phase);
+    Il= long_double_phase(Q, epsilon, &e_phase, pld, lambda, Il, e_phase,
+            p, n_iter);
 
     free(pld);
 
     *e_obs= e_phase;
     return Il;
 }
+
+/* The phased implementation, from the uniform distribution. */
+float
+ba_phased(csc_mat_t *Q, float epsilon, float *e_obs) {
+    double *p;
+    float Il;
+    int i;
+
+    p= malloc(Q->nrow * sizeof(double));
+    if(!p) { perror("malloc"); abort(); }
+    for(i= 0; i < Q->nrow; i++) p[i]= 1.0 / Q->nrow;
+
+    Il= ba_phased_warm(Q, epsilon, e_obs, p, NULL);
+
+    free(p);
+    return Il;
+}
@@ -38,4 +38,13 @@ float blahut_arimoto_ld_squeezed(csc_mat_t *Q, float epsilon, float *e_obs);
  * generally the best choice. */
 float ba_phased(csc_mat_t *Q, float epsilon, float *e_obs);
 
+/* As ba_phased, but starting from the input distribution p (Q->nrow
+ * entries), which is overwritten with the one that achieved the returned
+ * bound.  Restarting from a previous solution pays off when the matrices
+ * are very close; where they differ more, inputs that were driven towards
+ * zero can take longer to recover than starting afresh.  If n_iter is
+ * non-NULL, the number of iterations taken is stored there. */
+float ba_phased_warm(csc_mat_t *Q, float epsilon, float *e_obs, double *p,
+        int *n_iter);
+
 #endif /* __CHANNEL_ALGORITHMS_H */
@@ -12,13 +12,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "samples.h"
 #include "sparse.h"
 
-#define MAXLINE 1024
-
 int
 main(int argc, char *argv[]) {
-    bsc_hist_t *H;
+    bsc_hist_t *H= NULL;
     int c, r;
     FILE *out;
     int ne_cols= 0;
@@ -27,13 +26,18 @@ main(int argc, char *argv[]) {
     int cmin= INT_MIN, cmax= INT_MAX;
     int climit= -1;
     int *counts;
-    size_t malformed= 0, out_of_range= 0;
+    size_t out_of_range= 0;
     int discard= 0;
-    char buf[MAXLINE];
-
-    if(argc != 2 && argc != 4 && argc != 5 && argc != 6) {
+    smp_reader_t *R;
+    const smp_t *batch;
+    size_t n;
+    int nthreads= 1;
+    bsc_par_t *P= NULL;
+
+    if(argc != 2 && argc != 4 && argc != 5 && argc != 6 &&
+       argc != 7) {
         printf("Usage: %s <output_filename> [<col. min> <col. max> "
-               "[<count limit> [<discard>]]]\n",
+               "[<count limit> [<discard> [<threads>]]]]\n",
                 argv[0]);
         return 1;
     }
@@ -62,38 +66,45 @@ main(int argc, char *argv[]) {
         discard= atoi(argv[5]);
     }
 
+    if(argc >= 7) {
+        nthreads= atoi(argv[6]);
+        if(nthreads < 1) nthreads= 1;
+    }
+
     printf("Building histogram...");
     fflush(stdout);
-    H= bsc_hist_new();
-    while(fgets(buf, MAXLINE, stdin)) {
-        int n;
-
-        n= sscanf(buf, "%d %d\n", &c, &r);
-
-        if(n != 2) {
-            malformed++;
-            continue;
-        }
+    if(nthreads > 1) P= bsc_par_new(nthreads);
+    else             H= bsc_hist_new();
+    R= smp_reader_new(stdin);
+    while((n= smp_read(R, &batch)) > 0) {
+        size_t j;
+
+        for(j= 0; j < n; j++) {
+            c= batch[j].in;
+            r= batch[j].out;
+
+            if(c < cmin || cmax < c) {
+                out_of_range++;
+                continue;
+            }
 
-        if(c < cmin || cmax < c) {
-            out_of_range++;
-            continue;
-        }
+            if(climit >= 0) {
+                int i= c - cmin;
 
-        if(climit >= 0) {
-            int i= c - cmin;
+                if(counts[i] >= climit + discard)
+                    continue;
 
-            if(counts[i] >= climit + discard)
-                continue;
+                counts[i]++;
 
-            counts[i]++;
+                if(counts[i] <= discard)
+                    continue;
+            }
 
-            if(counts[i] <= discard)
-                continue;
+            if(P) bsc_par_count(P, c, r);
+            else  bsc_hist_count(H, c, r, 1);
         }
-
-        bsc_hist_count(H, c, r, 1);
     }
+    if(P) H= bsc_par_finish(P);
     printf(" done.\n");
     bsc_stats(H);
 
@@ -122,7 +133,8 @@ main(int argc, char *argv[]) {
     fclose(out);
 
     fprintf(stderr, "%lu malformed entries, %lu columns out of range\n",
-            malformed, out_of_range);
+            R->malformed, out_of_range);
+    smp_reader_destroy(R);
 
     return 0;
 }
@@ -13,13 +13,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "samples.h"
 #include "sparse.h"
 
-#define MAXLINE 1024
-
 int
 main(int argc, char *argv[]) {
-    bsc_hist_t *H;
+    bsc_hist_t *H= NULL;
     csc_mat_t *M;
     csc_errno_t e;
     int c, r;
@@ -28,12 +27,26 @@ main(int argc, char *argv[]) {
     int climit= -1;
     int *counts= NULL;
     int discard= 0;
-    size_t malformed= 0, out_of_range= 0;
-    char buf[MAXLINE];
+    size_t out_of_range= 0;
+    smp_reader_t *R;
+    const smp_t *batch;
+    size_t n;
+    int nthreads= 1;
+    bsc_par_t *P= NULL;
+    bsc_ext_t *X= NULL;
+    size_t budget= 0;
+
+    /* A memory budget, in MB, selects the bounded-memory build. */
+    if(argc > 2 && !strcmp(argv[1], "-m")) {
+        budget= (size_t)atol(argv[2]) << 20;
+        argc-= 2;
+        argv+= 2;
+    }
 
-    if(argc != 2 && argc != 4 && argc != 5 && argc != 6) {
-        printf("Usage: %s <output_filename> [<row. min> <row. max> "
-               "[<count limit> [<discard>]]]\n",
+    if(argc != 2 && argc != 4 && argc != 5 && argc != 6 &&
+       argc != 7) {
+        printf("Usage: %s [-m <MB>] <output_filename> [<row. min> "
+               "<row. max> [<count limit> [<discard> [<threads>]]]]\n",
                 argv[0]);
         return 1;
     }
@@ -62,47 +75,70 @@ main(int argc, char *argv[]) {
         discard= atoi(argv[5]);
     }
 
+    if(argc >= 7) {
+        nthreads= atoi(argv[6]);
+        if(nthreads < 1) nthreads= 1;
+    }
+
     printf("Building histogram...");
     fflush(stdout);
-    H= bsc_hist_new();
-    while(fgets(buf, MAXLINE, stdin)) {
-        int n;
-
-        n= sscanf(buf, "%d %d\n", &r, &c);
-
-        if(n != 2) {
-            malformed++;
-            continue;
-        }
+    if(budget > 0) {
+        if(nthreads > 1)
+            fprintf(stderr, "Bounded-memory build is serial, "
+                    "ignoring thread count\n");
+        X= bsc_ext_new(budget, NULL);
+    }
+    else if(nthreads > 1) P= bsc_par_new(nthreads);
+    else                  H= bsc_hist_new();
+    R= smp_reader_new(stdin);
+    while((n= smp_read(R, &batch)) > 0) {
+        size_t j;
+
+        for(j= 0; j < n; j++) {
+            r= batch[j].in;
+            c= batch[j].out;
+
+            if(r < rmin || rmax < r) {
+                out_of_range++;
+                continue;
+            }
 
-        if(r < rmin || rmax < r) {
-            out_of_range++;
-            continue;
-        }
+            if(climit >= 0) {
+                int i= r - rmin;
 
-        if(climit >= 0) {
-            int i= r - rmin;
+                if(counts[i] >= climit + discard)
+                    continue;
 
-            if(counts[i] >= climit + discard)
-                continue;
+                counts[i]++;
 
-            counts[i]++;
+                if(counts[i] <= discard)
+                    continue;
+            }
 
-            if(counts[i] <= discard)
-                continue;
+            if(X)      bsc_ext_count(X, c, r);
+            else if(P) bsc_par_count(P, c, r);
+            else       bsc_hist_count(H, c, r, 1);
         }
+    }
+    if(X) {
+        printf(" done, %d runs spilled.\n", X->nruns + (X->fill > 0));
 
-        bsc_hist_count(H, c, r, 1);
+        printf("Merging runs into matrix\n");
+        M= bsc_ext_finish(X);
+        csc_stats(M);
     }
-    printf(" done.\n");
-    bsc_stats(H);
+    else {
+        if(P) H= bsc_par_finish(P);
+        printf(" done.\n");
+        bsc_stats(H);
 
-    if(!bsc_check(H, 1)) abort();
+        if(!bsc_check(H, 1)) abort();
 
-    printf("Building matrix\n");
-    M= bsc_normalise(H);
-    csc_stats(M);
-    bsc_hist_destroy(H);
+        printf("Building matrix\n");
+        M= bsc_normalise(H);
+        csc_stats(M);
+        bsc_hist_destroy(H);
+    }
 
     if(!csc_check(M, 1)) abort();
 
@@ -139,7 +175,8 @@ main(int argc, char *argv[]) {
     fclose(out);
 
     printf("%lu malformed entries, %lu columns out of range\n",
-            malformed, out_of_range);
+            R->malformed, out_of_range);
+    smp_reader_destroy(R);
 
     return 0;
 }
@@ -3,22 +3,24 @@
 echo "Probing /proc/cpuinfo to update cpu.mk"
 echo -n "Have:"
 
-if grep sse2 /proc/cpuinfo > /dev/null
+: > cpu.mk
+
+if grep -qw sse2 /proc/cpuinfo 2> /dev/null
 then
     echo -n " SSE2"
-    echo "SSE2= 1" > cpu.mk
+    echo "SSE2= 1" >> cpu.mk
 fi
 
-if grep avx /proc/cpuinfo > /dev/null
+if grep -qw avx /proc/cpuinfo 2> /dev/null
 then
     echo -n " AVX"
-    echo "AVX= 1" > cpu.mk
+    echo "AVX= 1" >> cpu.mk
 fi
 
-if grep avx2 /proc/cpuinfo > /dev/null
+if grep -qw avx2 /proc/cpuinfo 2> /dev/null
 then
     echo -n " AVX2"
-    echo "AVX2= 1" > cpu.mk
+    echo "AVX2= 1" >> cpu.mk
 fi
 
 echo
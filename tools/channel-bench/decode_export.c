@@ -0,0 +1,417 @@
+/* decode_export.c
+
+   Expand the base64-encoded CBOR sections of a benchmark log, as written by
+   the manager with CONFIG_MANAGER_BINARY_EXPORT, back into the text that it
+   would otherwise have printed.  Everything outside the sections is passed
+   through, so the result can be fed to the extract_*_log.awk scripts.
+
+   Each section lies between "cbor64 start" and "cbor64 end" lines, and is
+   a CBOR array of the start line, the end line (or null), and a byte string
+   of data points.  Each point is two LEB128 varints: the zigzag-encoded
+   input, and the zigzag-encoded difference between the output and the
+   previous output in the section (starting from 0).
+
+   With -e, do the reverse: every section of a text log, from a line ending
+   in " start" up to the first line that isn't a plain "<input> <output>"
+   pair, is encoded as the manager would.  This is for testing, and for
+   estimating the saving on existing logs.
+
+   This code is experimental, and error-handling is primitive.
+*/
+
+/* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MARK_START "cbor64 start"
+#define MARK_END   "cbor64 end"
+
+/* Bytes of data points per chunk, as the manager sends them. */
+#define EXPORT_CHUNK 192
+
+static const char b64[]=
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/*** Decoding ***/
+
+/* A decoded section. */
+struct buf {
+    unsigned char *p;
+    size_t len, size, pos;
+};
+
+static void
+buf_put(struct buf *B, unsigned char c) {
+    if(B->len == B->size) {
+        B->size= B->size ? 2 * B->size : 4096;
+        B->p= realloc(B->p, B->size);
+        if(!B->p) { perror("realloc"); abort(); }
+    }
+    B->p[B->len++]= c;
+}
+
+static void
+malformed(const char *what) {
+    fprintf(stderr, "Malformed section: %s\n", what);
+    exit(EXIT_FAILURE);
+}
+
+static unsigned char
+get_byte(struct buf *B) {
+    if(B->pos >= B->len) malformed("truncated");
+    return B->p[B->pos++];
+}
+
+/* Read a CBOR item head, returning the major type, and its argument in *v.
+ * Indefinite lengths give *v == -1. */
+static int
+get_head(struct buf *B, uint64_t *v) {
+    unsigned char ib= get_byte(B);
+    int ai= ib & 0x1f, n, i;
+
+    if(ai < 24) { *v= ai; return ib >> 5; }
+    if(ai == 31) { *v= (uint64_t)-1; return ib >> 5; }
+    if(ai > 27) malformed("reserved additional information");
+
+    n= 1 << (ai - 24);
+    *v= 0;
+    for(i= 0; i < n; i++) *v= (*v << 8) | get_byte(B);
+
+    return ib >> 5;
+}
+
+/* Read a UTF-8 string (or null) into a fresh buffer. */
+static char *
+get_text(struct buf *B) {
+    uint64_t len;
+    char *s;
+    int mt;
+
+    mt= get_head(B, &len);
+    if(mt == 7 && len == 22) return NULL;
+    if(mt != 3 || len == (uint64_t)-1) malformed("expected a string");
+    if(len > B->len - B->pos) malformed("truncated string");
+
+    s= malloc(len + 1);
+    if(!s) { perror("malloc"); abort(); }
+    memcpy(s, B->p + B->pos, len);
+    s[len]= '\0';
+    B->pos+= len;
+
+    return s;
+}
+
+static uint64_t
+get_varint(const unsigned char *p, size_t len, size_t *i) {
+    uint64_t v= 0;
+    int shift= 0;
+
+    while(1) {
+        unsigned char c;
+
+        if(*i >= len || shift > 63) malformed("truncated data point");
+        c= p[(*i)++];
+        v|= (uint64_t)(c & 0x7f) << shift;
+        if(!(c & 0x80)) return v;
+        shift+= 7;
+    }
+}
+
+static int64_t
+unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/* Print the data points in a byte string, carrying the delta state
+ * between chunks. */
+static void
+print_points(const unsigned char *p, size_t len, uint64_t *prev) {
+    size_t i= 0;
+
+    while(i < len) {
+        int64_t in= unzigzag(get_varint(p, len, &i));
+
+        *prev+= (uint64_t)unzigzag(get_varint(p, len, &i));
+        printf("%" PRId64 " %" PRIu64 "\n", in, *prev);
+    }
+}
+
+static void
+print_section(struct buf *B) {
+    char *start, *end;
+    uint64_t v, prev= 0;
+    int mt;
+
+    B->pos= 0;
+    if(get_head(B, &v) != 4 || v != 3) malformed("expected a 3-array");
+
+    start= get_text(B);
+    end= get_text(B);
+    if(!start) malformed("no start line");
+    printf("%s\n", start);
+
+    mt= get_head(B, &v);
+    if(mt != 2) malformed("expected a byte string");
+
+    if(v != (uint64_t)-1) {
+        if(v > B->len - B->pos) malformed("truncated byte string");
+        print_points(B->p + B->pos, v, &prev);
+        B->pos+= v;
+    }
+    else {
+        /* Chunks, up to a break. */
+        while(B->pos < B->len && B->p[B->pos] != 0xff) {
+            if(get_head(B, &v) != 2 || v == (uint64_t)-1)
+                malformed("expected a chunk");
+            if(v > B->len - B->pos) malformed("truncated chunk");
+            /* A point never spans chunks. */
+            print_points(B->p + B->pos, v, &prev);
+            B->pos+= v;
+        }
+        get_byte(B);
+    }
+
+    if(end) printf("%s\n", end);
+
+    free(start);
+    free(end);
+}
+
+static int
+decode(FILE *in) {
+    char line[4096];
+    struct buf B= { NULL, 0, 0, 0 };
+    int in_section= 0;
+    uint32_t bits= 0;
+    int nbits= 0;
+
+    while(fgets(line, sizeof(line), in)) {
+        char *p;
+
+        if(!in_section) {
+            if(!strncmp(line, MARK_START, strlen(MARK_START)) &&
+               strspn(line + strlen(MARK_START), " \r\n") ==
+                    strlen(line + strlen(MARK_START))) {
+                in_section= 1;
+                B.len= 0;
+                bits= 0;
+                nbits= 0;
+            }
+            else fputs(line, stdout);
+            continue;
+        }
+
+        if(!strncmp(line, MARK_END, strlen(MARK_END))) {
+            print_section(&B);
+            in_section= 0;
+            continue;
+        }
+
+        /* Anything but base64 (whitespace, padding) is skipped. */
+        for(p= line; *p; p++) {
+            const char *c= strchr(b64, *p);
+
+            if(!c) continue;
+            bits= (bits << 6) | (c - b64);
+            nbits+= 6;
+            if(nbits >= 8) {
+                nbits-= 8;
+                buf_put(&B, (bits >> nbits) & 0xff);
+            }
+        }
+    }
+
+    if(in_section) malformed("no end line");
+
+    free(B.p);
+    return 0;
+}
+
+/*** Encoding ***/
+
+struct enc {
+    uint32_t bits;
+    int nbits;
+    unsigned char chunk[EXPORT_CHUNK];
+    size_t fill;
+    uint64_t prev;
+};
+
+static void
+put_byte(struct enc *E, unsigned char c) {
+    E->bits= (E->bits << 8) | c;
+    E->nbits+= 8;
+    while(E->nbits >= 6) {
+        E->nbits-= 6;
+        putchar(b64[(E->bits >> E->nbits) & 0x3f]);
+    }
+}
+
+static void
+put_head(struct enc *E, int mt, uint64_t v) {
+    int n, ai;
+
+    if(v < 24)               { ai= v;  n= 0; }
+    else if(v < 0x100)       { ai= 24; n= 1; }
+    else if(v < 0x10000)     { ai= 25; n= 2; }
+    else if(v < 0x100000000) { ai= 26; n= 4; }
+    else                     { ai= 27; n= 8; }
+
+    put_byte(E, (mt << 5) | ai);
+    while(n-- > 0) put_byte(E, (v >> (8 * n)) & 0xff);
+}
+
+static void
+put_text(struct enc *E, const char *s) {
+    size_t len= strlen(s);
+
+    put_head(E, 3, len);
+    while(len-- > 0) put_byte(E, *s++);
+}
+
+static void
+flush_chunk(struct enc *E) {
+    size_t i;
+
+    if(E->fill == 0) return;
+    put_head(E, 2, E->fill);
+    for(i= 0; i < E->fill; i++) put_byte(E, E->chunk[i]);
+    E->fill= 0;
+    putchar('\n');
+}
+
+static void
+put_varint(struct enc *E, uint64_t v) {
+    while(v >= 0x80) {
+        E->chunk[E->fill++]= (v & 0x7f) | 0x80;
+        v>>= 7;
+    }
+    E->chunk[E->fill++]= v;
+}
+
+static uint64_t
+zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+/* Emit any leftover bits, padded, as libutils' base64_terminate does. */
+static void
+terminate(struct enc *E) {
+    if(E->nbits > 0) {
+        int pad= 6 - E->nbits;
+
+        putchar(b64[(E->bits << pad) & 0x3f]);
+        for(; pad > 0; pad-= 2) putchar('=');
+        E->nbits= 0;
+    }
+}
+
+struct point {
+    int in;
+    uint64_t out;
+};
+
+static void
+encode_section(const char *start, const char *end, struct point *pts,
+               size_t n) {
+    struct enc E;
+    size_t i;
+
+    memset(&E, 0, sizeof(E));
+
+    printf(MARK_START "\n");
+    put_head(&E, 4, 3);
+    put_text(&E, start);
+    if(end) put_text(&E, end);
+    else    put_byte(&E, 0xf6); /* null */
+    put_byte(&E, 0x5f);         /* Indefinite-length byte string. */
+
+    for(i= 0; i < n; i++) {
+        if(E.fill + 20 > EXPORT_CHUNK) flush_chunk(&E);
+        put_varint(&E, zigzag(pts[i].in));
+        put_varint(&E, zigzag((int64_t)(pts[i].out - E.prev)));
+        E.prev= pts[i].out;
+    }
+    flush_chunk(&E);
+
+    put_byte(&E, 0xff);         /* Break. */
+    terminate(&E);
+    printf("\n" MARK_END "\n");
+}
+
+/* Strip the line ending, returning the line's length without it. */
+static size_t
+chomp(char *line) {
+    size_t len= strlen(line);
+
+    if(len > 0 && line[len-1] == '\n') line[--len]= '\0';
+    return len;
+}
+
+/* Parse a data point, accepting only what the manager would print. */
+static int
+parse_point(const char *line, struct point *pt) {
+    char check[64];
+    unsigned long long o;
+
+    if(sscanf(line, "%d %llu", &pt->in, &o) != 2) return 0;
+    pt->out= o;
+    snprintf(check, sizeof(check), "%d %llu", pt->in, o);
+    return !strcmp(check, line);
+}
+
+static int
+encode(FILE *in) {
+    char line[4096], *start= NULL;
+    struct point *pts= NULL;
+    size_t n= 0, size= 0;
+
+    while(fgets(line, sizeof(line), in)) {
+        size_t len= chomp(line);
+
+        if(start) {
+            if(n == size) {
+                size= size ? 2 * size : 4096;
+                pts= realloc(pts, size * sizeof(struct point));
+                if(!pts) { perror("realloc"); abort(); }
+            }
+            if(parse_point(line, &pts[n])) {
+                n++;
+                continue;
+            }
+
+            /* Anything else ends the section. */
+            encode_section(start, line, pts, n);
+            free(start);
+            start= NULL;
+        }
+        else if(len >= 6 && !strcmp(line + len - 6, " start")) {
+            start= strdup(line);
+            if(!start) { perror("strdup"); abort(); }
+            n= 0;
+        }
+        else printf("%s\n", line);
+    }
+
+    if(start) {
+        encode_section(start, NULL, pts, n);
+        free(start);
+    }
+    free(pts);
+
+    return 0;
+}
+
+int
+main(int argc, char *argv[]) {
+    if(argc > 1 && !strcmp(argv[1], "-e")) return encode(stdin);
+    if(argc > 1) {
+        fprintf(stderr, "Usage: %s [-e] < log\n", argv[0]);
+        return 1;
+    }
+    return decode(stdin);
+}
@@ -1,6 +1,7 @@
 /* drop_samples.c
 
-   Drop n samples from every modulation.
+   Drop n samples from every modulation.  The output is in the same (text or
+   binary) format as the input.
 
    This code is experimental, and error-handling is primitive.
 */
@@ -10,13 +11,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#define MAX_LINE 1024
+#include "samples.h"
 
 int
 main(int argc, char *argv[]) {
     int in_old= -1, count= 0, discard;
-    int in, out;
-    char buf[MAX_LINE];
+    smp_reader_t *R;
+    smp_writer_t *W;
+    const smp_t *batch;
+    size_t n;
 
     if(argc < 2) {
         fprintf(stderr, "Usage: %s <samples to discard per modulation>\n",
@@ -26,16 +29,24 @@ main(int argc, char *argv[]) {
 
     discard= atoi(argv[1]);
 
-    while(fgets(buf, MAX_LINE, stdin)) {
-        if(sscanf(buf, "%d %d", &in, &out) == 2) {
-            if(in != in_old) {
-                in_old= in;
+    R= smp_reader_new(stdin);
+    W= smp_writer_new(stdout, R->binary);
+
+    while((n= smp_read(R, &batch)) > 0) {
+        size_t i;
+
+        for(i= 0; i < n; i++) {
+            if(batch[i].in != in_old) {
+                in_old= batch[i].in;
                 count= 0;
             }
             count++;
-            if(count > discard) printf("%d %d\n", in, out);
+            if(count > discard) smp_write(W, batch[i].in, batch[i].out);
         }
     }
 
+    smp_writer_destroy(W);
+    smp_reader_destroy(R);
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,101 @@
+/* export_host.c
+
+   Encode a text benchmark log using the manager's own exporter
+   (apps/manager/src/export.c, built with CONFIG_MANAGER_BINARY_EXPORT),
+   so that decode_export can be checked against the encoder that actually
+   runs on the target, rather than only its own -e encoder.
+
+   Sections are found as by decode_export -e: from a line ending in
+   " start" up to the first line that isn't a plain "<input> <output>"
+   pair, which is taken as the end line.
+
+   This code is experimental, and error-handling is primitive.
+*/
+
+/* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "export.h"
+
+struct point {
+    int in;
+    uint64_t out;
+};
+
+/* Strip the line ending, returning the line's length without it. */
+static size_t
+chomp(char *line) {
+    size_t len= strlen(line);
+
+    if(len > 0 && line[len-1] == '\n') line[--len]= '\0';
+    return len;
+}
+
+/* Parse a data point, accepting only what the manager would print. */
+static int
+parse_point(const char *line, struct point *pt) {
+    char check[64];
+    unsigned long long o;
+
+    if(sscanf(line, "%d %llu", &pt->in, &o) != 2) return 0;
+    pt->out= o;
+    snprintf(check, sizeof(check), "%d %llu", pt->in, o);
+    return !strcmp(check, line);
+}
+
+int
+main(int argc, char *argv[]) {
+    char line[4096], *start= NULL;
+    struct point *pts= NULL;
+    size_t n= 0, size= 0, i;
+    export_t e;
+
+    if(argc > 1) {
+        fprintf(stderr, "Usage: %s < log\n", argv[0]);
+        return 1;
+    }
+
+    while(fgets(line, sizeof(line), stdin)) {
+        size_t len= chomp(line);
+
+        if(start) {
+            if(n == size) {
+                size= size ? 2 * size : 4096;
+                pts= realloc(pts, size * sizeof(struct point));
+                if(!pts) { perror("realloc"); abort(); }
+            }
+            if(parse_point(line, &pts[n])) {
+                n++;
+                continue;
+            }
+
+            /* The manager knows its end line up front. */
+            export_start(&e, start, line);
+            for(i= 0; i < n; i++) export_point(&e, pts[i].in, pts[i].out);
+            export_end(&e);
+            free(start);
+            start= NULL;
+        }
+        else if(len >= 6 && !strcmp(line + len - 6, " start")) {
+            start= strdup(line);
+            if(!start) { perror("strdup"); abort(); }
+            n= 0;
+        }
+        else printf("%s\n", line);
+    }
+
+    /* The manager never leaves a section open, so pass it through. */
+    if(start) {
+        printf("%s\n", start);
+        for(i= 0; i < n; i++)
+            printf("%d %llu\n", pts[i].in, (unsigned long long)pts[i].out);
+        free(start);
+    }
+    free(pts);
+
+    return 0;
+}
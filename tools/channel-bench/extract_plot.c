@@ -51,8 +51,8 @@ main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    M= csc_load_binary(in, &e);
-    if(!M) { csc_perror(e, "csc_load_binary"); exit(EXIT_FAILURE); }
+    M= csc_map_binary(in, &e);
+    if(!M) { csc_perror(e, "csc_map_binary"); exit(EXIT_FAILURE); }
     fclose(in);
 
     if(!csc_check(M, 1)) abort();
@@ -6,8 +6,13 @@
 #
 # Copyright 2016, DATA61.  See COPYRIGHT for license details.
 
-BEGIN           { running= 0 }
-/probing time start/  { running= 1; next }
-/probing time end/ { exit }
+# With -v experiment=N, take the Nth experiment of a log from a manager
+# built with a test plan (ManagerCovertPlan), which tags each experiment with
+# a "covert experiment N: ..." line.
+
+BEGIN           { running= 0; skip= (experiment != "") }
+/^covert experiment [0-9]+:/ { if($3 == experiment ":") skip= 0 }
+/probing time start/  { if(!skip) running= 1; next }
+/probing time end/ { if(!skip) exit }
                 { if(running) print }
 
@@ -1,6 +1,7 @@
 /* filter_samples.c
 
-   Filter out-of-range samples.
+   Filter out-of-range samples.  The output is in the same (text or binary)
+   format as the input.
 
    This code is experimental, and error-handling is primitive.
 */
@@ -10,14 +11,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#define LINE_MAX 1024
+#include "samples.h"
 
 int
 main(int argc, char *argv[]) {
     int cmin, cmax, rmin, rmax;
-    int c, r;
     int discarded= 0;
-    char buf[LINE_MAX];
+    smp_reader_t *R;
+    smp_writer_t *W;
+    const smp_t *batch;
+    size_t n;
 
     if(argc < 5) {
         fprintf(stderr, "Usage: %s <cmin> <cmax> <rmin> <rmax>\n", argv[0]);
@@ -29,17 +32,27 @@ main(int argc, char *argv[]) {
     rmin= atoi(argv[3]);
     rmax= atoi(argv[4]);
 
-    while(fgets(buf, LINE_MAX, stdin)) {
-        if(sscanf(buf,"%d %d\n", &c, &r) == 2) {
+    R= smp_reader_new(stdin);
+    W= smp_writer_new(stdout, R->binary);
+
+    while((n= smp_read(R, &batch)) > 0) {
+        size_t i;
+
+        for(i= 0; i < n; i++) {
+            int c= batch[i].in, r= batch[i].out;
+
             if(cmin <= c && c <= cmax &&
                rmin <= r && r <= rmax) {
-                printf("%d %d\n", c, r);
-                fflush(stdout);
+                smp_write(W, c, r);
             }
             else discarded++;
         }
+        smp_flush(W);
     }
 
+    smp_writer_destroy(W);
+    smp_reader_destroy(R);
+
     fprintf(stderr, "Discarded %d samples\n", discarded);
 
     return 0;
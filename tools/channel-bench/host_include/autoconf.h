@@ -0,0 +1,2 @@
+/* Stand-in for the seL4 build's configuration header, for building
+   manager sources on the host. */
@@ -0,0 +1,3 @@
+/* Stand-in for the manager's generated configuration, for building its
+   exporter on the host (see export_host.c). */
+#define CONFIG_MANAGER_BINARY_EXPORT 1
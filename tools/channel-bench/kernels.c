@@ -0,0 +1,239 @@
+/* kernels.c
+
+   Runtime selection of vectorised kernels.  The bodies in kernels_body.h
+   are compiled for the build's baseline target, and on x86, additionally
+   for AVX2+FMA and AVX-512.  The best variant the CPU supports is chosen
+   on first use.
+
+   This code is experimental, and error-handling is primitive.
+*/
+
+/* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
+
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERN_X86
+#include <immintrin.h>
+#endif
+
+struct kern_ops {
+    const char *isa;
+    float  (*max_f)(const float *, int);
+    double (*max_d)(const double *, int);
+    int    (*log2_f)(float *, const float *, int);
+    int    (*log2_d)(double *, const double *, int);
+    float  (*exp2_dot_f)(const float *, const float *, float, float, int);
+    double (*exp2_dot_d)(const double *, const double *, double, double,
+                         int);
+    float  (*exp2_scale_f)(float *, const float *, float, int);
+    void   (*exp2_scale_d)(double *, const double *, double, double, int);
+    void   (*div_f)(float *, float, int);
+    void   (*mult_cf_4)(dv_t *, dv_t *, csc_mat_t *);
+    void   (*mult_cf_8)(dv_t *, dv_t *, csc_mat_t *);
+    void   (*mult_cf_16)(dv_t *, dv_t *, csc_mat_t *);
+};
+
+/* The baseline, for whatever the build targets. */
+#define KERN(f) f##_generic
+#define KERN_ISA "generic"
+#include "kernels_body.h"
+#undef KERN_ISA
+#undef KERN
+
+#ifdef KERN_X86
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#define KERN(f) f##_avx2
+#define KERN_ISA "avx2"
+
+/* Stride 8 fills a ymm register: one gather of x per row block. */
+#define KERN_HAVE_MULT_CF_8
+static void
+mult_cf_8_avx2(dv_t *y, dv_t *x, csc_mat_t *A) {
+    int s;
+
+    for(s= 0; s < A->ncol/8; s++) {
+        __m256 acc= _mm256_setzero_ps();
+        int i;
+
+        for(i= A->si[s]; i < A->si[s+1]; i+= 8) {
+            __m256i o= _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64((const __m128i *)(A->row_offsets + i)));
+            __m256 xv= _mm256_i32gather_ps(
+                x->entries + A->rows[i/8], o, sizeof(float));
+
+            acc= _mm256_fmadd_ps(_mm256_loadu_ps(A->entries + i), xv, acc);
+        }
+
+        _mm256_storeu_ps(y->entries + s*8, acc);
+    }
+}
+
+#include "kernels_body.h"
+#undef KERN_HAVE_MULT_CF_8
+#undef KERN_ISA
+#undef KERN
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq,avx2,fma")
+#define KERN(f) f##_avx512
+#define KERN_ISA "avx512"
+
+/* Stride 8 as for AVX2, and stride 16 fills a zmm register. */
+#define KERN_HAVE_MULT_CF_8
+static void
+mult_cf_8_avx512(dv_t *y, dv_t *x, csc_mat_t *A) {
+    mult_cf_8_avx2(y, x, A);
+}
+
+#define KERN_HAVE_MULT_CF_16
+static void
+mult_cf_16_avx512(dv_t *y, dv_t *x, csc_mat_t *A) {
+    int s;
+
+    for(s= 0; s < A->ncol/16; s++) {
+        __m512 acc= _mm512_setzero_ps();
+        int i;
+
+        for(i= A->si[s]; i < A->si[s+1]; i+= 16) {
+            __m512i o= _mm512_cvtepu8_epi32(
+                _mm_loadu_si128((const __m128i *)(A->row_offsets + i)));
+            __m512 xv= _mm512_i32gather_ps(
+                o, x->entries + A->rows[i/16], sizeof(float));
+
+            acc= _mm512_fmadd_ps(_mm512_loadu_ps(A->entries + i), xv, acc);
+        }
+
+        _mm512_storeu_ps(y->entries + s*16, acc);
+    }
+}
+
+#include "kernels_body.h"
+#undef KERN_HAVE_MULT_CF_16
+#undef KERN_HAVE_MULT_CF_8
+#undef KERN_ISA
+#undef KERN
+#pragma GCC pop_options
+#endif /* KERN_X86 */
+
+static const struct kern_ops *ops;
+static pthread_once_t ops_once= PTHREAD_ONCE_INIT;
+
+static void
+kern_select(void) {
+    const char *force= getenv("KERNEL_ISA");
+    int have_avx2= 0, have_avx512= 0;
+
+#ifdef KERN_X86
+    __builtin_cpu_init();
+    have_avx2= __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    have_avx512= have_avx2 && __builtin_cpu_supports("avx512f") &&
+                 __builtin_cpu_supports("avx512dq");
+#endif
+
+    ops= &ops_generic;
+#ifdef KERN_X86
+    if(have_avx512)    ops= &ops_avx512;
+    else if(have_avx2) ops= &ops_avx2;
+#endif
+    if(!force) return;
+
+    if(!strcmp(force, "generic")) {
+        ops= &ops_generic;
+        return;
+    }
+    if(!strcmp(force, "avx2") || !strcmp(force, "avx512")) {
+#ifdef KERN_X86
+        int avx512= !strcmp(force, "avx512");
+
+        if(avx512 ? have_avx512 : have_avx2) {
+            ops= avx512 ? &ops_avx512 : &ops_avx2;
+            return;
+        }
+#endif
+        fprintf(stderr, "KERNEL_ISA=%s is not supported here, using %s\n",
+                force, ops->isa);
+        return;
+    }
+    fprintf(stderr, "Unknown KERNEL_ISA=%s (generic, avx2 or avx512), "
+                    "using %s\n", force, ops->isa);
+}
+
+static inline const struct kern_ops *
+kern_ops(void) {
+    pthread_once(&ops_once, kern_select);
+    return ops;
+}
+
+const char *
+kern_isa(void) {
+    return kern_ops()->isa;
+}
+
+float
+kern_max_f(const float *x, int n) {
+    return kern_ops()->max_f(x, n);
+}
+
+double
+kern_max_d(const double *x, int n) {
+    return kern_ops()->max_d(x, n);
+}
+
+int
+kern_log2_f(float *y, const float *x, int n) {
+    return kern_ops()->log2_f(y, x, n);
+}
+
+int
+kern_log2_d(double *y, const double *x, int n) {
+    return kern_ops()->log2_d(y, x, n);
+}
+
+float
+kern_exp2_dot_f(const float *p, const float *z, float a, float b, int n) {
+    return kern_ops()->exp2_dot_f(p, z, a, b, n);
+}
+
+double
+kern_exp2_dot_d(const double *p, const double *z, double a, double b,
+                int n) {
+    return kern_ops()->exp2_dot_d(p, z, a, b, n);
+}
+
+float
+kern_exp2_scale_f(float *p, const float *z, float a, int n) {
+    return kern_ops()->exp2_scale_f(p, z, a, n);
+}
+
+void
+kern_exp2_scale_d(double *p, const double *z, double a, double d, int n) {
+    kern_ops()->exp2_scale_d(p, z, a, d, n);
+}
+
+void
+kern_div_f(float *p, float d, int n) {
+    kern_ops()->div_f(p, d, n);
+}
+
+int
+kern_mult_cf(dv_t *y, dv_t *x, csc_mat_t *A) {
+    assert(A->flags & CSC_F_CFREE);
+
+    switch(STRIDE_OF(A)) {
+        case 4:  kern_ops()->mult_cf_4(y, x, A);  return 1;
+        case 8:  kern_ops()->mult_cf_8(y, x, A);  return 1;
+        case 16: kern_ops()->mult_cf_16(y, x, A); return 1;
+        default: return 0;
+    }
+}
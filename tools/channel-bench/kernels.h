@@ -0,0 +1,49 @@
+/* kernels.h
+
+   Vectorised inner loops for the sparse matrix library and the
+   Blahut-Arimoto implementations.  Each kernel is compiled once per
+   supported instruction set, and the best variant for the running CPU is
+   selected at startup.
+
+   This code is experimental, and error-handling is primitive.
+*/
+
+/* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
+
+#ifndef __KERNELS_H
+#define __KERNELS_H
+
+#include "sparse.h"
+
+/* The selected variant, one of "generic", "avx2" or "avx512".  Set
+ * $KERNEL_ISA to force a (supported) choice, e.g. for benchmarking. */
+const char *kern_isa(void);
+
+/* Maximum entry. */
+float  kern_max_f(const float *x, int n);
+double kern_max_d(const double *x, int n);
+
+/* y= log2(x), returning the number of zero entries of x. */
+int kern_log2_f(float *y, const float *x, int n);
+int kern_log2_d(double *y, const double *x, int n);
+
+/* Returns sum_i p[i] * 2^(a * z[i] + b). */
+float  kern_exp2_dot_f(const float *p, const float *z, float a, float b,
+                       int n);
+double kern_exp2_dot_d(const double *p, const double *z, double a, double b,
+                       int n);
+
+/* p[i]*= 2^(a * z[i]), returning the sum of the new p. */
+float kern_exp2_scale_f(float *p, const float *z, float a, int n);
+/* p[i]= p[i] * 2^(a * z[i]) / d */
+void kern_exp2_scale_d(double *p, const double *z, double a, double d,
+                       int n);
+
+/* p[i]/= d */
+void kern_div_f(float *p, float d, int n);
+
+/* Collision-free multiplication, y= x * A.  Returns 0 (having done
+ * nothing) if no kernel handles the stride of A. */
+int kern_mult_cf(dv_t *y, dv_t *x, csc_mat_t *A);
+
+#endif /* __KERNELS_H */
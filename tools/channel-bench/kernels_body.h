@@ -0,0 +1,160 @@
+/* kernels_body.h
+
+   Kernel bodies, included by kernels.c once per instruction set, with
+   KERN(f) naming that variant.  The loops are written to auto-vectorise,
+   calling the vector variants of log2/exp2 from libmvec under -ffast-math.
+
+   This code is experimental, and error-handling is primitive.
+*/
+
+/* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
+
+static float
+KERN(max_f)(const float *x, int n) {
+    float m= -INFINITY;
+    int i;
+
+    for(i= 0; i < n; i++) m= x[i] > m ? x[i] : m;
+
+    return m;
+}
+
+static double
+KERN(max_d)(const double *x, int n) {
+    double m= -INFINITY;
+    int i;
+
+    for(i= 0; i < n; i++) m= x[i] > m ? x[i] : m;
+
+    return m;
+}
+
+static int
+KERN(log2_f)(float *restrict y, const float *restrict x, int n) {
+    int i, zeros= 0;
+
+    for(i= 0; i < n; i++) {
+        zeros+= (x[i] == 0);
+        y[i]= log2f(x[i]);
+    }
+
+    return zeros;
+}
+
+static int
+KERN(log2_d)(double *restrict y, const double *restrict x, int n) {
+    int i, zeros= 0;
+
+    for(i= 0; i < n; i++) {
+        zeros+= (x[i] == 0);
+        y[i]= log2(x[i]);
+    }
+
+    return zeros;
+}
+
+static float
+KERN(exp2_dot_f)(const float *restrict p, const float *restrict z,
+                 float a, float b, int n) {
+    float s= 0.0;
+    int i;
+
+    for(i= 0; i < n; i++) s+= p[i] * exp2f(a * z[i] + b);
+
+    return s;
+}
+
+static double
+KERN(exp2_dot_d)(const double *restrict p, const double *restrict z,
+                 double a, double b, int n) {
+    double s= 0.0;
+    int i;
+
+    for(i= 0; i < n; i++) s+= p[i] * exp2(a * z[i] + b);
+
+    return s;
+}
+
+static float
+KERN(exp2_scale_f)(float *restrict p, const float *restrict z, float a,
+                   int n) {
+    float s= 0.0;
+    int i;
+
+    for(i= 0; i < n; i++) {
+        p[i]*= exp2f(a * z[i]);
+        s+= p[i];
+    }
+
+    return s;
+}
+
+static void
+KERN(exp2_scale_d)(double *restrict p, const double *restrict z, double a,
+                   double d, int n) {
+    int i;
+
+    for(i= 0; i < n; i++) p[i]= p[i] * exp2(a * z[i]) / d;
+}
+
+static void
+KERN(div_f)(float *p, float d, int n) {
+    int i;
+
+    for(i= 0; i < n; i++) p[i]/= d;
+}
+
+/* Collision-free multiplication, for a fixed stride S.  Within each block,
+ * the S lanes are independent, and the x values are gathered by row
+ * offset. */
+#define KERN_MULT_CF(S)                                                     \
+static void                                                                 \
+KERN(mult_cf_##S)(dv_t *y, dv_t *x, csc_mat_t *A) {                         \
+    int s;                                                                  \
+                                                                            \
+    for(s= 0; s < A->ncol/S; s++) {                                         \
+        float acc[S];                                                       \
+        int i, l;                                                           \
+                                                                            \
+        for(l= 0; l < S; l++) acc[l]= 0.0;                                  \
+                                                                            \
+        for(i= A->si[s]; i < A->si[s+1]; i+= S) {                           \
+            const float *restrict e= A->entries + i;                        \
+            const uint8_t *restrict o= A->row_offsets + i;                  \
+            const float *restrict xb= x->entries + A->rows[i/S];            \
+                                                                            \
+            for(l= 0; l < S; l++) acc[l]+= e[l] * xb[o[l]];                 \
+        }                                                                   \
+                                                                            \
+        for(l= 0; l < S; l++) y->entries[s*S + l]= acc[l];                  \
+    }                                                                       \
+}
+
+/* An instruction set may supply its own, e.g. using gathers. */
+#ifndef KERN_HAVE_MULT_CF_4
+KERN_MULT_CF(4)
+#endif
+#ifndef KERN_HAVE_MULT_CF_8
+KERN_MULT_CF(8)
+#endif
+#ifndef KERN_HAVE_MULT_CF_16
+KERN_MULT_CF(16)
+#endif
+
+#undef KERN_MULT_CF
+
+static const struct kern_ops KERN(ops) = {
+    .isa=          KERN_ISA,
+    .max_f=        KERN(max_f),
+    .max_d=        KERN(max_d),
+    .log2_f=       KERN(log2_f),
+    .log2_d=       KERN(log2_d),
+    .exp2_dot_f=   KERN(exp2_dot_f),
+    .exp2_dot_d=   KERN(exp2_dot_d),
+    .exp2_scale_f= KERN(exp2_scale_f),
+    .exp2_scale_d= KERN(exp2_scale_d),
+    .div_f=        KERN(div_f),
+    .mult_cf_4=    KERN(mult_cf_4),
+    .mult_cf_8=    KERN(mult_cf_8),
+    .mult_cf_16=   KERN(mult_cf_16),
+};
@@ -1,50 +1,205 @@
 /* log.c
 
-   Table-based single-precision logarithm.
+   Table-based single-precision logarithm.  The table is built once, and
+   cached in a file that later runs map read-only.
 
    This code is experimental, and error-handling is primitive.
 */
 
 /* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <math.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
 
+#ifdef __SSE2__
 #include <immintrin.h>
+#endif
+
+#include "log.h"
+
+#define LOG_TABLE_MAGIC "LOG2TBL1"
+
+/* The table has 2^log_table_bits + 1 entries, covering [1,2] (the last is
+ * needed for interpolation), indexed by the most-significant bits of the
+ * mantissa.  With fewer than 23 bits, the remaining mantissa bits
+ * interpolate linearly between neighbouring entries. */
+const float *log_table;
+int log_table_bits= LOG_TABLE_MAX_BITS;
+static int log_shift;
+static uint32_t log_frac_mask;
+static float log_frac_scale;
+
+/* Header of a cached table file.  The entries follow. */
+struct log_table_header {
+    char magic[8];
+    int32_t bits;
+    int32_t entries;
+};
+
+static void
+fill_log_table(float *table, int bits) {
+    int i, entries= 1 << bits;
+
+    for(i= 0; i <= entries; i++)
+        table[i]= log2f(1.0f + (float)i / entries);
+}
+
+/* Find (and create) the cache directory: $LOG_TABLE_CACHE, or
+ * $XDG_CACHE_HOME/channel-bench, or ~/.cache/channel-bench.  Returns 0 if
+ * caching is disabled, by setting LOG_TABLE_CACHE to the empty string. */
+static int
+log_cache_path(char *path, size_t len, int bits) {
+    const char *dir= getenv("LOG_TABLE_CACHE");
+    char base[PATH_MAX - 32];
+
+    if(dir) {
+        if(!dir[0]) return 0;
+        snprintf(base, sizeof(base), "%s", dir);
+    }
+    else if(getenv("XDG_CACHE_HOME")) {
+        snprintf(base, sizeof(base), "%s", getenv("XDG_CACHE_HOME"));
+        mkdir(base, 0755);
+        snprintf(base, sizeof(base), "%s/channel-bench",
+                 getenv("XDG_CACHE_HOME"));
+    }
+    else if(getenv("HOME")) {
+        snprintf(base, sizeof(base), "%s/.cache", getenv("HOME"));
+        mkdir(base, 0755);
+        snprintf(base, sizeof(base), "%s/.cache/channel-bench",
+                 getenv("HOME"));
+    }
+    else return 0;
+
+    if(mkdir(base, 0755) && errno != EEXIST) return 0;
+
+    snprintf(path, len, "%s/log2_table.%d", base, bits);
+
+    return 1;
+}
+
+/* Map a cached table, if there's a valid one. */
+static const float *
+map_log_table(const char *path, int bits) {
+    struct log_table_header *hdr;
+    struct stat st;
+    size_t len= sizeof(*hdr) + ((1 << bits) + 1) * sizeof(float);
+    void *map;
+    int fd;
+
+    fd= open(path, O_RDONLY);
+    if(fd < 0) return NULL;
+
+    if(fstat(fd, &st) || st.st_size != len) { close(fd); return NULL; }
 
-#define TABLE_BITS 23
-#define TABLE_ENTRIES (1<<(TABLE_BITS))
-#define TABLE_BASE ((float)1.0)
-#define TABLE_INCREMENT ((float)1.0/TABLE_ENTRIES)
+    map= mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return NULL;
 
-float log_table[TABLE_ENTRIES];
+    hdr= map;
+    if(memcmp(hdr->magic, LOG_TABLE_MAGIC, sizeof(hdr->magic)) ||
+       hdr->bits != bits || hdr->entries != (1 << bits) + 1) {
+        munmap(map, len);
+        return NULL;
+    }
+
+    return (const float *)(hdr + 1);
+}
+
+/* Write a table to the cache.  The file is renamed into place, so that
+ * concurrent tools never see a partial table. */
+static void
+store_log_table(const char *path, const float *table, int bits) {
+    struct log_table_header hdr;
+    char tmp[PATH_MAX + 32];
+    FILE *f;
+    size_t n= (1 << bits) + 1;
+
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+    f= fopen(tmp, "wb");
+    if(!f) return;
+
+    memcpy(hdr.magic, LOG_TABLE_MAGIC, sizeof(hdr.magic));
+    hdr.bits= bits;
+    hdr.entries= n;
+
+    if(fwrite(&hdr, sizeof(hdr), 1, f) != 1 ||
+       fwrite(table, sizeof(float), n, f) != n) {
+        fclose(f);
+        unlink(tmp);
+        return;
+    }
+    if(fclose(f) || rename(tmp, path)) unlink(tmp);
+}
+
+void
+set_log_table_bits(int bits) {
+    if(bits < LOG_TABLE_MIN_BITS) bits= LOG_TABLE_MIN_BITS;
+    if(bits > LOG_TABLE_MAX_BITS) bits= LOG_TABLE_MAX_BITS;
+    log_table_bits= bits;
+}
 
 void
 write_log_table(void) {
-    int i;
+    char path[PATH_MAX];
+    int cache;
+    float *table;
+
+    if(getenv("LOG_TABLE_BITS"))
+        set_log_table_bits(atoi(getenv("LOG_TABLE_BITS")));
+
+    log_shift= LOG_TABLE_MAX_BITS - log_table_bits;
+    log_frac_mask= (1 << log_shift) - 1;
+    log_frac_scale= 1.0f / (1 << log_shift);
+
+    /* Use the cached copy, if we have one. */
+    cache= log_cache_path(path, sizeof(path), log_table_bits);
+    if(cache) {
+        log_table= map_log_table(path, log_table_bits);
+        if(log_table) return;
+    }
+
+    table= malloc(((1 << log_table_bits) + 1) * sizeof(float));
+    if(!table) { perror("malloc"); abort(); }
+    fill_log_table(table, log_table_bits);
+    if(cache) store_log_table(path, table, log_table_bits);
+
+    log_table= table;
+}
+
+/* Look up mantissa m, interpolating if the table is reduced. */
+static inline float
+log_lookup(uint32_t m) {
+    const float *t= log_table + (m >> log_shift);
 
-    for(i= 0; i < TABLE_ENTRIES; i++)
-        log_table[i]= log2f(TABLE_BASE + i*TABLE_INCREMENT);
+    if(log_shift == 0) return t[0];
+    else return t[0] + (t[1] - t[0]) * ((m & log_frac_mask) * log_frac_scale);
 }
 
 float
 log2f_table(float x) {
-    __v4sf y;
     uint32_t raw;
     int exp, mantissa;
     float v;
 
     /* Get the float as a uint32. */
-    y[0]= x;
-    raw= ((__v4si) y)[0];
+    memcpy(&raw, &x, sizeof(raw));
 
     /* Extract mantissa and exponent. */
     exp= (raw >> 23) & 0xff;
     mantissa= raw & 0x7fffff;
 
     /* Lookup the base value using the most-significant bits. */
-    v= log_table[mantissa >> (23 - TABLE_BITS)];
+    v= log_lookup(mantissa);
 
     /* Add in the (de-biased) exponent. */
     return v + (exp - 127);
@@ -65,10 +220,10 @@ log2f_table_v(__v4sf x) {
     mantissa= raw & 0x7fffff;
 
     /* Lookup the base value using the most-significant bits. */
-    v[0]= log_table[mantissa[0] >> (23 - TABLE_BITS)];
-    v[1]= log_table[mantissa[1] >> (23 - TABLE_BITS)];
-    v[2]= log_table[mantissa[2] >> (23 - TABLE_BITS)];
-    v[3]= log_table[mantissa[3] >> (23 - TABLE_BITS)];
+    v[0]= log_lookup(mantissa[0]);
+    v[1]= log_lookup(mantissa[1]);
+    v[2]= log_lookup(mantissa[2]);
+    v[3]= log_lookup(mantissa[3]);
 
     /* Add in the (de-biased) exponent. */
     return v + __builtin_ia32_cvtdq2ps(exp);
@@ -92,14 +247,14 @@ log2f_table_v8(__v8sf x) {
     mantissa= raw & 0x7fffff;
 
     /* Lookup the base value using the most-significant bits. */
-    v[0]= log_table[mantissa[0] >> (23 - TABLE_BITS)];
-    v[1]= log_table[mantissa[1] >> (23 - TABLE_BITS)];
-    v[2]= log_table[mantissa[2] >> (23 - TABLE_BITS)];
-    v[3]= log_table[mantissa[3] >> (23 - TABLE_BITS)];
-    v[4]= log_table[mantissa[4] >> (23 - TABLE_BITS)];
-    v[5]= log_table[mantissa[5] >> (23 - TABLE_BITS)];
-    v[6]= log_table[mantissa[6] >> (23 - TABLE_BITS)];
-    v[7]= log_table[mantissa[7] >> (23 - TABLE_BITS)];
+    v[0]= log_lookup(mantissa[0]);
+    v[1]= log_lookup(mantissa[1]);
+    v[2]= log_lookup(mantissa[2]);
+    v[3]= log_lookup(mantissa[3]);
+    v[4]= log_lookup(mantissa[4]);
+    v[5]= log_lookup(mantissa[5]);
+    v[6]= log_lookup(mantissa[6]);
+    v[7]= log_lookup(mantissa[7]);
 
     /* Add in the (de-biased) exponent. */
     return v + __builtin_ia32_cvtdq2ps256(exp);
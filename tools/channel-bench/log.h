@@ -1,8 +1,22 @@
 #ifndef __LOG_H
 #define __LOG_H
 
+#if defined(__SSE2__) || defined(__AVX__)
 #include <x86intrin.h>
+#endif
+
+/* Table sizes, as log2(entries).  The full table (2^23 entries, 32MB) is
+ * exact for single precision.  Smaller tables interpolate, and at 14 bits
+ * or less fit comfortably in L2. */
+#define LOG_TABLE_MAX_BITS 23
+#define LOG_TABLE_MIN_BITS 4
+
+extern int log_table_bits;
 
+/* Choose the table size.  Must be called before write_log_table, and is
+ * overridden by $LOG_TABLE_BITS. */
+void set_log_table_bits(int bits);
+/* Build or map the table.  Must be called before using log2f_table. */
 void write_log_table(void);
 float log2f_table(float x);
 
@@ -25,10 +25,23 @@ main(int argc, char *argv[]) {
     double iv;
     float x, y;
     float emax= 0.0;
+#ifdef __SSE2__
     __v4sf w, z;
+#endif
+#ifdef __AVX__
     __v8sf w8, z8;
+#endif
 
+    if(argc > 1) set_log_table_bits(atoi(argv[1]));
+
+    clock_gettime(CLOCK_REALTIME, &start);
     write_log_table();
+    clock_gettime(CLOCK_REALTIME, &end);
+
+    iv= end.tv_sec   + end.tv_nsec*1e-9
+      - start.tv_sec - start.tv_nsec*1e-9;
+    printf("Table of 2^%d entries (%.1fkB) ready in %.2es\n",
+           log_table_bits, ((1 << log_table_bits) + 1) * 4 / 1024.0, iv);
 
     x= 0;
     for(i= 0; i < 2 * TEST_STEPS; i++) {
@@ -65,6 +78,7 @@ main(int argc, char *argv[]) {
       - start.tv_sec - start.tv_nsec*1e-9;
     printf("%d reps %.2esec %.2e/s\n", REPS, iv, REPS / iv);
 
+#ifdef __SSE2__
     w[0]= 1.0; w[1]= 1.1; w[2]= 1.2; w[3]= 1.3;
     z[0]= 0.0; z[1]= 0.0; z[2]= 0.0; z[3]= 0.0;
     clock_gettime(CLOCK_REALTIME, &start);
@@ -79,7 +93,9 @@ main(int argc, char *argv[]) {
     iv= end.tv_sec   + end.tv_nsec*1e-9
       - start.tv_sec - start.tv_nsec*1e-9;
     printf("%d reps %.2esec %.2e/s\n", REPS, iv, 4 * REPS / iv);
+#endif
 
+#ifdef __AVX__
     w8[0]= 1.0; w8[1]= 1.1; w8[2]= 1.2; w8[3]= 1.3;
     z8[0]= 0.0; z8[1]= 0.0; z8[2]= 0.0; z8[3]= 0.0;
     clock_gettime(CLOCK_REALTIME, &start);
@@ -94,6 +110,7 @@ main(int argc, char *argv[]) {
     iv= end.tv_sec   + end.tv_nsec*1e-9
       - start.tv_sec - start.tv_nsec*1e-9;
     printf("%d reps %.2esec %.2e/s\n", REPS, iv, 8 * REPS / iv);
+#endif
 
     return 0;
 }
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <time.h>
 
+#include "kernels.h"
 #include "sparse.h"
 
 #define REPS 10
@@ -33,8 +34,8 @@ main(int argc, char *argv[]) {
     in= fopen(argv[1], "rb");
     if(!in) { perror("fopen"); exit(EXIT_FAILURE); }
 
-    M= csc_load_binary(in, &e);
-    if(!M) { csc_perror(e, "csc_load_binary"); exit(EXIT_FAILURE); }
+    M= csc_map_binary(in, &e);
+    if(!M) { csc_perror(e, "csc_map_binary"); exit(EXIT_FAILURE); }
     fclose(in);
 
     x= dv_new(M->nrow);
@@ -45,6 +46,7 @@ main(int argc, char *argv[]) {
 
     if(!csc_check(M, 1)) abort();
     csc_stats(M);
+    printf("Kernels: %s\n", kern_isa());
 
     dv_uniform(x, 1.0);
 
@@ -0,0 +1,48 @@
+/* pack_samples.c
+
+   Convert a sample stream between the text and binary formats.  By default,
+   packs text (or binary) input into the binary format.  With -d, unpacks
+   to text.
+
+   This code is experimental, and error-handling is primitive.
+*/
+
+/* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "samples.h"
+
+int
+main(int argc, char *argv[]) {
+    int unpack= 0;
+    smp_reader_t *R;
+    smp_writer_t *W;
+    const smp_t *batch;
+    size_t n;
+
+    if(argc > 2 || (argc == 2 && strcmp(argv[1], "-d"))) {
+        fprintf(stderr, "Usage: %s [-d]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if(argc == 2) unpack= 1;
+
+    R= smp_reader_new(stdin);
+    W= smp_writer_new(stdout, !unpack);
+
+    while((n= smp_read(R, &batch)) > 0) {
+        size_t i;
+
+        for(i= 0; i < n; i++) smp_write(W, batch[i].in, batch[i].out);
+    }
+
+    smp_writer_destroy(W);
+
+    fprintf(stderr, "%lu samples, %lu malformed\n",
+            (unsigned long)R->nread, (unsigned long)R->malformed);
+    smp_reader_destroy(R);
+
+    return EXIT_SUCCESS;
+}
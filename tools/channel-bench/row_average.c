@@ -38,8 +38,8 @@ main(int argc, char *argv[]) {
     in= fopen(argv[1], "rb");
     if(!in) { perror("fopen"); return 1; }
 
-    Q= csc_load_binary(in, &e);
-    if(!Q) { csc_perror(e, "csc_load_binary"); return 1; }
+    Q= csc_map_binary(in, &e);
+    if(!Q) { csc_perror(e, "csc_map_binary"); return 1; }
 
     fclose(in);
     if(!quiet) printf(" done.\n");
@@ -11,6 +11,7 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <malloc.h>
 #include <math.h>
 #include <pthread.h>
 #include <stdio.h>
@@ -23,154 +24,205 @@
 #include "sparse.h"
 #include "dSFMT-src-2.2.1/dSFMT.h"
 #include "channel_algorithms.h"
+#include "sampling.h"
 
-/* Sample from the given distribution. sample the c, the column , 
- sample the output (colunm value) according to a randomly chosen probablity*/
-int
-sample(dv_t *cp, dsfmt_t *rng) {
-    /* Choose x in [0,1). */
-    float x= dsfmt_genrand_close_open(rng);
-    int s= 0, e= cp->length;
+/* A capacity step: the distributions to sample, and the capacity of the
+ * channel they describe. */
+struct step {
+    float cap;
+    struct alias *la;
+    struct alias *ra;
+};
 
-    /* Binary search for last point with cumulative probability <= x. */
-    while(s+1 < e) {
-        int m= (s+e)/2;
+/* The result of a single simulation. */
+struct result {
+    float I, e;
+    int done;
+};
 
-        if(x < cp->entries[m]) e= m;
-        else                   s= m;
-    }
+/* Jobs handed to a worker at once, from the shared stream. */
+#define POOL_BLOCK 8
 
-    return s;
-}
-
-/* Generate a matrix by taking 'samples' samples per column from the given
- * distributions, using lcp for the left-hand side and rcp for the right. */
-csc_mat_t *
-sampled_matrix(dv_t *lcp, dv_t *rcp, int rows, int samples, dsfmt_t *rng) {
-    bsc_hist_t *H;
-    csc_mat_t *M;
-    int r;
+/* A worker's queue of jobs, the index range [lo,hi).  The owner takes jobs
+ * from the bottom, and idle workers steal half from the top. */
+struct deque {
+    pthread_mutex_t lock;
+    int64_t lo, hi;
+    pthread_t thread;
+    int i;
+    struct pool *P;
+};
 
-    H= bsc_hist_new();
-    for(r= 0; r < rows; r++) {
-        int i;
+/* A pool of workers, running the (step, replicate) jobs of a simulation.
+ * Job j is replicate j % runs of step j / runs, and draws its samples from
+ * an RNG seeded from (seed, j) alone, so the results are the same for any
+ * number of workers.  They are printed in job order, as soon as all earlier
+ * jobs have finished. */
+struct pool {
+    struct step *steps;
+    int runs;
+    int64_t njobs;
+    float epsilon;
+    int rows;
+    int samples;
+    int ncol;
+    uint32_t seed;
 
-        for(i= 0; i < samples; i++) {
-            int c;
-            if(r < rows/2)
-                c= sample(lcp, rng);
-            else
-                c= sample(rcp, rng);
-            bsc_hist_count(H, c, r, 1);
-        }
-    }
-    M= bsc_normalise(H);
-    bsc_hist_destroy(H);
-    return M;
-}
+    /* Jobs not yet handed to any worker. */
+    pthread_mutex_t feed_lock;
+    int64_t next_block;
 
-/* Average along the columns of the matrix. */
-dv_t *
-average_cols(csc_mat_t *M) {
-    dv_t *v;
-    int c;
-    float Ps= 0.0;
+    int nthreads;
+    struct deque *dq;
 
-    v= dv_new(M->ncol);
-    if(!v) {
-        perror("dv_new");
-        exit(EXIT_FAILURE);
-    }
-    dv_zero(v);
+    /* Finished jobs, waiting to be printed in order. */
+    pthread_mutex_t output_lock;
+    struct result *results;
+    int64_t next_out;
+};
 
-    for(c= 0; c < M->ncol; c++) {
-        int64_t i;
+/* The RNG seed for job j. */
+static uint32_t
+job_seed(uint32_t seed, int64_t j) {
+    /* splitmix64, to decorrelate neighbouring jobs. */
+    uint64_t z= ((uint64_t)seed << 32) + (uint64_t)j + 0x9e3779b97f4a7c15ULL;
+    z= (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z= (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (uint32_t)(z ^ (z >> 31));
+}
 
-        for(i= M->ci[c]; i < M->ci[c+1]; i++) {
-            if(M->entries[i] == 0) continue;
-            v->entries[c]+= M->entries[i];
+/* Find the next job for worker i, refilling from the stream, or stealing.
+ * Returns 0 once there are no unstarted jobs left. */
+static int
+pool_take(struct pool *P, int i, int64_t *j) {
+    struct deque *D= &P->dq[i];
+    int64_t lo, hi;
+    int k;
+
+    pthread_mutex_lock(&D->lock);
+    if(D->lo < D->hi) {
+        *j= D->lo++;
+        pthread_mutex_unlock(&D->lock);
+        return 1;
+    }
+    pthread_mutex_unlock(&D->lock);
+
+    /* Take the next block from the stream. */
+    pthread_mutex_lock(&P->feed_lock);
+    lo= P->next_block;
+    hi= lo + POOL_BLOCK < P->njobs ? lo + POOL_BLOCK : P->njobs;
+    P->next_block= hi;
+    pthread_mutex_unlock(&P->feed_lock);
+
+    /* The stream is dry, so steal the top half of another worker's range. */
+    for(k= 1; lo >= hi && k < P->nthreads; k++) {
+        struct deque *V= &P->dq[(i + k) % P->nthreads];
+
+        pthread_mutex_lock(&V->lock);
+        if(V->lo < V->hi) {
+            hi= V->hi;
+            lo= V->hi - (V->hi - V->lo + 1) / 2;
+            V->hi= lo;
         }
+        pthread_mutex_unlock(&V->lock);
     }
 
-    /* Rescale to ensure total prob = 1, each entry contains the prob of seeing the colunm value given all the total number of colunm values*/
-    for(c= 0; c < v->length; c++) Ps+= v->entries[c];
-    for(c= 0; c < v->length; c++) v->entries[c]/= Ps;
+    if(lo >= hi) return 0;
 
-    return v;
-}
+    pthread_mutex_lock(&D->lock);
+    D->lo= lo + 1;
+    D->hi= hi;
+    pthread_mutex_unlock(&D->lock);
 
-/* Calculate the cumulative probability. */
-dv_t *
-accumulate_prob(dv_t *p) {
-    dv_t *cp;
-    float Pc= 0.0;
-    int i;
+    *j= lo;
+    return 1;
+}
 
-    cp= dv_new(p->length);
-    if(!cp) {
-        perror("dv_new");
-        exit(EXIT_FAILURE);
-    }
-    
-    /*the accumulated probablity of seeing the colunm i, as the colunm values are ordered as the index of the entry*/
-    for(i= 0; i < p->length; i++) {
-        Pc+= p->entries[i];
-        cp->entries[i]= Pc;
+/* Record the result of job j, and print all results now in order. */
+static void
+pool_finish(struct pool *P, int64_t j, float I, float e) {
+    pthread_mutex_lock(&P->output_lock);
+    P->results[j].I= I;
+    P->results[j].e= e;
+    P->results[j].done= 1;
+    while(P->next_out < P->njobs && P->results[P->next_out].done) {
+        struct result *R= &P->results[P->next_out];
+
+        printf("%.12e %.12e %.12e\n",
+               P->steps[P->next_out / P->runs].cap, R->I, R->e);
+        P->next_out++;
     }
-
-    return cp;
+    /* Very important, as the simulation is long-running and may be
+     * interrupted.  You don't want to lose an hour's calculation in the
+     * buffer. */
+    fflush(stdout);
+    pthread_mutex_unlock(&P->output_lock);
 }
 
-/* Don't let the workers trample each other's output. */
-pthread_mutex_t output_lock= PTHREAD_MUTEX_INITIALIZER;
+/* Workers run jobs until none are left, reusing one set of buffers. */
+static void *
+worker(void *arg) {
+    struct deque *D= (struct deque *)arg;
+    struct pool *P= D->P;
+    struct sampler *S= sampler_new(P->rows, P->samples, P->ncol);
+    dsfmt_t rng;
+    int64_t j;
 
-/* Generate n noisy matrices, and print their capacity. */
-void
-noisy_matrices(float cap, dv_t *lcp, dv_t *rcp, float epsilon, int n,
-        int rows, int samples, dsfmt_t *rng) {
-    int i;
+    while(pool_take(P, D->i, &j)) {
+        struct step *St= &P->steps[j / P->runs];
+        csc_mat_t *M;
+        float I, e;
 
-    for(i= 0; i < n; i++) {
+        dsfmt_init_gen_rand(&rng, job_seed(P->seed, j));
         /* Draw the samples. */
-        csc_mat_t *M= sampled_matrix(lcp, rcp, rows, samples, rng);
-        float I, e;
-        /* We may have empty columns, which the ABA doesn't like. */
-        csc_prune_cols(M);
+        M= sampled_matrix(S, St->la, St->ra, &rng);
         /* Find the capacity (mutual information). */
-        I= ba_phased(M, epsilon, &e);
-        /* Deallocate the matrix. */
-        csc_mat_destroy(M);
+        I= ba_phased(M, P->epsilon, &e);
         /* Print the capacity. */
-        pthread_mutex_lock(&output_lock);
-        printf("%.12e %.12e %.12e\n", cap, I, e);
-        /* Very important, as the simulation is long-running and may be
-         * interrupted.  You don't want to lose an hour's calculation in the
-         * buffer. */
-        fflush(stdout);
-        pthread_mutex_unlock(&output_lock);
+        pool_finish(P, j, I, e);
     }
+
+    sampler_destroy(S);
+    return (void *)0;
 }
 
-/* A worker thread's context. */
-struct job {
-    float cap;
-    dv_t *lcp;
-    dv_t *rcp;
-    float epsilon;
-    int n;
-    int rows;
-    int samples;
-    dsfmt_t rng;
-    pthread_t thread;
-};
+/* Run all jobs on n workers. */
+static void
+pool_run(struct pool *P, int n) {
+    int i;
 
-/* Worker threads simply call noisy_matrices. */
-static void *
-worker(void *arg) {
-    struct job *j= (struct job *)arg;
-    noisy_matrices(j->cap, j->lcp, j->rcp, j->epsilon, j->n, j->rows,
-            j->samples, &j->rng);
-    return (void *)0;
+    P->nthreads= n;
+    P->next_block= 0;
+    P->next_out= 0;
+    pthread_mutex_init(&P->feed_lock, NULL);
+    pthread_mutex_init(&P->output_lock, NULL);
+
+    P->results= calloc(P->njobs, sizeof(struct result));
+    P->dq= calloc(n, sizeof(struct deque));
+    if(!P->results || !P->dq) { perror("calloc"); abort(); }
+
+    for(i= 0; i < n; i++) {
+        pthread_mutex_init(&P->dq[i].lock, NULL);
+        P->dq[i].i= i;
+        P->dq[i].P= P;
+        if(pthread_create(&P->dq[i].thread, NULL, worker, &P->dq[i])) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for(i= 0; i < n; i++) {
+        if(pthread_join(P->dq[i].thread, NULL)) {
+            perror("pthread_join");
+            exit(EXIT_FAILURE);
+        }
+        pthread_mutex_destroy(&P->dq[i].lock);
+    }
+    assert(P->next_out == P->njobs);
+
+    pthread_mutex_destroy(&P->feed_lock);
+    pthread_mutex_destroy(&P->output_lock);
+    free(P->dq);
+    free(P->results);
 }
 
 /* Take a distribution and cut it in half. */
@@ -324,22 +376,20 @@ main(int argc, char *argv[]) {
     csc_errno_t e;
     dv_t *avg_prob;
     dv_t *top_half, *bot_half;
-    int samples, runs, runs_per_job;
+    int samples, runs;
     float epsilon;
     int cap_steps, start_step, end_step;
-    int nthreads;
-    struct job *jobs;
-    int seed;
+    int nthreads= 0;
+    struct pool P;
+    uint32_t seed= time(NULL);
     int quiet= 0;
     int i, s;
 
-    srandom(time(NULL));
-
     if(argc < 8) {
         fprintf(stderr,
                 "Usage: %s <channel matrix> <samples per column> "
                 "<runs> <max error> <capacity steps> <start step> "
-                "<end step> [-q]\n", argv[0]);
+                "<end step> [-q] [-s <seed>] [-j <threads>]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
 
@@ -353,11 +403,21 @@ main(int argc, char *argv[]) {
     start_step= atoi(argv[6]);
     end_step= atoi(argv[7]);
 
-    if(argc > 8 && !strcmp(argv[8], "-q"))
-        quiet= 1;
+    for(i= 8; i < argc; i++) {
+        if(!strcmp(argv[i], "-q"))
+            quiet= 1;
+        else if(!strcmp(argv[i], "-s") && i + 1 < argc)
+            seed= strtoul(argv[++i], NULL, 0);
+        else if(!strcmp(argv[i], "-j") && i + 1 < argc)
+            nthreads= atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Unrecognised option %s\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    M= csc_load_binary(in, &e);
-    if(!M) { csc_perror(e, "csc_load_binary"); exit(EXIT_FAILURE); }
+    M= csc_map_binary(in, &e);
+    if(!M) { csc_perror(e, "csc_map_binary"); exit(EXIT_FAILURE); }
     fclose(in);
 
     if(!csc_check(M, 1)) abort();
@@ -375,69 +435,55 @@ main(int argc, char *argv[]) {
     split_prob(avg_prob, &top_half, &bot_half);
     if(!quiet) fprintf(stderr, " done.\n");
 
-    nthreads= sysconf(_SC_NPROCESSORS_ONLN);
+    if(nthreads < 1) nthreads= sysconf(_SC_NPROCESSORS_ONLN);
     if(nthreads < 1) nthreads= 1;
 
     write_log_table();
 
-    jobs= malloc(nthreads * sizeof(struct job));
-    if(!jobs) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
+    if(end_step < start_step) end_step= start_step;
 
-    if(!quiet) fprintf(stderr, "Generating noisy matrices...");
-    if(!quiet) fflush(stderr);
+    P.runs= runs > 0 ? runs : 0;
+    P.njobs= (int64_t)(end_step - start_step) * P.runs;
+    P.epsilon= epsilon;
+    P.rows= M->nrow;
+    P.samples= samples;
+    P.ncol= M->ncol;
+    P.seed= seed;
+    P.steps= calloc(end_step - start_step + 1, sizeof(struct step));
+    if(!P.steps) { perror("calloc"); abort(); }
 
+    /* Prepare the distributions for every step. */
     for(s= start_step; s < end_step; s++) {
-        dv_t *left_prob, *right_prob,
-             *left_cprob, *right_cprob;
+        struct step *S= &P.steps[s - start_step];
+        dv_t *left_prob, *right_prob;
         float alpha= 0.5 + s * (0.5 / cap_steps);
-        float cap;
-        int runs_step= runs;
 
         left_prob= join_prob(top_half, bot_half, alpha);
         right_prob= join_prob(top_half, bot_half, 1.0 - alpha);
-        left_cprob= accumulate_prob(left_prob);
-        right_cprob= accumulate_prob(right_prob);
+        S->la= alias_new(left_prob);
+        S->ra= alias_new(right_prob);
 
         /* Find the capacity of the step matrix. */
-        cap= find_binary_cap(left_prob, right_prob, epsilon);
-
-        runs_per_job= runs_step / nthreads;
-        for(i= 0; i < nthreads; i++) {
-            jobs[i].cap= cap;
-            jobs[i].lcp= left_cprob;
-            jobs[i].rcp= right_cprob;
-            jobs[i].epsilon= epsilon;
-            jobs[i].n= runs_per_job;
-            jobs[i].rows= M->nrow;
-            jobs[i].samples= samples;
-            seed= random();
-            dsfmt_init_gen_rand(&jobs[i].rng, seed);
-            runs_step-= runs_per_job;
-        }
-        jobs[nthreads-1].n+= runs_step;
-        for(i= 0; i < nthreads; i++) {
-            if(pthread_create(&jobs[i].thread, NULL, worker, &jobs[i])) {
-                perror("pthread_create");
-                exit(EXIT_FAILURE);
-            }
-        }
-        for(i= 0; i < nthreads; i++) {
-            if(pthread_join(jobs[i].thread, NULL)) {
-                perror("pthread_join");
-                exit(EXIT_FAILURE);
-            }
-        }
+        S->cap= find_binary_cap(left_prob, right_prob, epsilon);
 
         dv_destroy(left_prob);
         dv_destroy(right_prob);
-        dv_destroy(left_cprob);
-        dv_destroy(right_cprob);
     }
+
+    if(!quiet) fprintf(stderr, "Generating noisy matrices (seed %u)...",
+                       seed);
+    if(!quiet) fflush(stderr);
+
+    pool_run(&P, nthreads);
+
     if(!quiet) fprintf(stderr, " done.\n");
 
+    for(s= start_step; s < end_step; s++) {
+        alias_destroy(P.steps[s - start_step].la);
+        alias_destroy(P.steps[s - start_step].ra);
+    }
+    free(P.steps);
+
     dv_destroy(avg_prob);
     dv_destroy(top_half);
     dv_destroy(bot_half);
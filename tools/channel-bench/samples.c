@@ -0,0 +1,334 @@
+/* samples.c
+
+   Streaming input and output of "input output" sample pairs, in either the
+   traditional text format, or a compact fixed-width binary format.
+
+   This code is experimental, and error-handling is primitive.
+*/
+
+/* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "samples.h"
+
+/* Size of the raw input and output buffers. */
+#define RAW_BUF (1 << 22)
+#define OUT_BUF (1 << 20)
+
+/* The longest possible text record, "-2147483648 -2147483648\n". */
+#define MAX_TEXT_REC 24
+
+/* Refill the raw buffer from the stream, preserving unconsumed bytes. */
+static void
+smp_fill(smp_reader_t *R) {
+    size_t n;
+
+    if(R->mapped || R->eof) return;
+
+    if(R->start > 0) {
+        memmove(R->buf, R->buf + R->start, R->end - R->start);
+        R->end-= R->start;
+        R->start= 0;
+    }
+
+    if(R->end == R->buf_size) return;
+
+    n= fread(R->buf + R->end, 1, R->buf_size - R->end, R->f);
+    if(ferror(R->f)) { perror("fread"); abort(); }
+    if(n == 0) R->eof= 1;
+    R->end+= n;
+}
+
+/* Ensure that at least n bytes are available, if the stream has them. */
+static int
+smp_want(smp_reader_t *R, size_t n) {
+    while(R->end - R->start < n && !R->eof) smp_fill(R);
+    return R->end - R->start >= n;
+}
+
+/* Check, and consume, a binary stream header. */
+static void
+smp_read_header(smp_reader_t *R) {
+    smp_header_t hdr;
+
+    if(!smp_want(R, sizeof(smp_header_t))) {
+        fprintf(stderr, "Truncated sample stream header\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(&hdr, R->buf + R->start, sizeof(smp_header_t));
+    assert(!strncmp(hdr.magic, SMP_MAGIC, SMP_MAGIC_LEN));
+    if(hdr.ver > SMP_VERSION) {
+        fprintf(stderr, "Unknown sample stream version %d\n", hdr.ver);
+        exit(EXIT_FAILURE);
+    }
+    if(hdr.recsize != sizeof(smp_t)) {
+        fprintf(stderr, "Unsupported sample record size %d\n", hdr.recsize);
+        exit(EXIT_FAILURE);
+    }
+
+    R->start+= sizeof(smp_header_t);
+}
+
+smp_reader_t *
+smp_reader_new(FILE *f) {
+    smp_reader_t *R;
+    struct stat st;
+
+    assert(f);
+
+    R= calloc(1, sizeof(smp_reader_t));
+    if(!R) { perror("calloc"); abort(); }
+    R->f= f;
+
+    /* Map regular files whole, if we're at the start. */
+    if(fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) &&
+       st.st_size > 0 && ftello(f) == 0) {
+        void *map= mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+                        fileno(f), 0);
+        if(map != MAP_FAILED) {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            R->buf= map;
+            R->buf_size= st.st_size;
+            R->end= st.st_size;
+            R->mapped= 1;
+            R->eof= 1;
+        }
+    }
+
+    if(!R->mapped) {
+        R->buf_size= RAW_BUF;
+        R->buf= malloc(R->buf_size);
+        if(!R->buf) { perror("malloc"); abort(); }
+    }
+
+    /* Detect the format. */
+    if(smp_want(R, SMP_MAGIC_LEN) &&
+       !strncmp(R->buf + R->start, SMP_MAGIC, SMP_MAGIC_LEN)) {
+        R->binary= 1;
+        smp_read_header(R);
+    }
+    else {
+        R->batch= malloc(SMP_BATCH * sizeof(smp_t));
+        if(!R->batch) { perror("malloc"); abort(); }
+    }
+
+    return R;
+}
+
+void
+smp_reader_destroy(smp_reader_t *R) {
+    assert(R);
+    if(R->mapped) munmap(R->buf, R->buf_size);
+    else free(R->buf);
+    free(R->batch);
+    free(R);
+}
+
+/* Binary input is returned in place, without copying. */
+static size_t
+smp_read_binary(smp_reader_t *R, const smp_t **batch) {
+    int32_t magic_word;
+
+    memcpy(&magic_word, SMP_MAGIC, sizeof(int32_t));
+
+    while(1) {
+        const smp_t *s;
+        size_t i, n;
+
+        if(!smp_want(R, sizeof(smp_t))) {
+            if(R->end > R->start) {
+                fprintf(stderr, "Discarding %lu trailing bytes\n",
+                        (unsigned long)(R->end - R->start));
+                R->start= R->end;
+            }
+            return 0;
+        }
+
+        s= (const smp_t *)(R->buf + R->start);
+        n= (R->end - R->start) / sizeof(smp_t);
+        if(n > SMP_BATCH) n= SMP_BATCH;
+
+        /* Skip any header embedded by concatenating streams.  A sample that
+         * merely starts with the same word is returned on its own. */
+        if(s[0].in == magic_word) {
+            if(smp_want(R, SMP_MAGIC_LEN) &&
+               !strncmp(R->buf + R->start, SMP_MAGIC, SMP_MAGIC_LEN)) {
+                smp_read_header(R);
+                continue;
+            }
+            s= (const smp_t *)(R->buf + R->start);
+            i= 1;
+        }
+        else {
+            for(i= 1; i < n && s[i].in != magic_word; i++);
+        }
+
+        R->start+= i * sizeof(smp_t);
+        R->nread+= i;
+        *batch= s;
+        return i;
+    }
+}
+
+/* Parse a decimal integer, skipping leading whitespace, as %d does. */
+static inline int
+parse_int(const char **pp, const char *e, int32_t *v) {
+    const char *p= *pp;
+    int neg= 0;
+    int64_t x= 0;
+
+    while(p < e && (*p == ' ' || *p == '\t' || *p == '\r' ||
+                    *p == '\v' || *p == '\f'))
+        p++;
+    if(p < e && (*p == '-' || *p == '+')) {
+        neg= (*p == '-');
+        p++;
+    }
+    if(p == e || *p < '0' || *p > '9') return 0;
+    while(p < e && '0' <= *p && *p <= '9') {
+        x= x * 10 + (*p - '0');
+        p++;
+    }
+
+    *v= (int32_t)(neg ? -x : x);
+    *pp= p;
+    return 1;
+}
+
+/* Text input is parsed a line at a time into the reader's batch. */
+static size_t
+smp_read_text(smp_reader_t *R, const smp_t **batch) {
+    size_t n= 0;
+
+    while(n < SMP_BATCH) {
+        const char *p, *e, *nl;
+
+        p= R->buf + R->start;
+        nl= memchr(p, '\n', R->end - R->start);
+        if(!nl && !R->eof && R->end - R->start < R->buf_size) {
+            smp_fill(R);
+            continue;
+        }
+        if(!nl && R->start == R->end) break;
+
+        /* The final line may be unterminated, and over-long lines are
+         * split, as with fgets. */
+        e= nl ? nl : R->buf + R->end;
+
+        if(parse_int(&p, e, &R->batch[n].in) &&
+           parse_int(&p, e, &R->batch[n].out))
+            n++;
+        else
+            R->malformed++;
+
+        R->start= (e - R->buf) + (nl ? 1 : 0);
+    }
+
+    R->nread+= n;
+    *batch= R->batch;
+    return n;
+}
+
+size_t
+smp_read(smp_reader_t *R, const smp_t **batch) {
+    assert(R);
+    assert(batch);
+
+    if(R->binary) return smp_read_binary(R, batch);
+    else          return smp_read_text(R, batch);
+}
+
+smp_writer_t *
+smp_writer_new(FILE *f, int binary) {
+    smp_writer_t *W;
+
+    assert(f);
+
+    W= calloc(1, sizeof(smp_writer_t));
+    if(!W) { perror("calloc"); abort(); }
+    W->f= f;
+    W->binary= binary;
+    W->buf= malloc(OUT_BUF);
+    if(!W->buf) { perror("malloc"); abort(); }
+
+    if(binary) {
+        smp_header_t hdr;
+
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, SMP_MAGIC, SMP_MAGIC_LEN);
+        hdr.ver= SMP_VERSION;
+        hdr.flags= 0;
+        hdr.recsize= sizeof(smp_t);
+
+        memcpy(W->buf, &hdr, sizeof(hdr));
+        W->fill= sizeof(hdr);
+    }
+
+    return W;
+}
+
+void
+smp_flush(smp_writer_t *W) {
+    assert(W);
+
+    if(W->fill > 0 && fwrite(W->buf, 1, W->fill, W->f) != W->fill) {
+        perror("fwrite");
+        abort();
+    }
+    W->fill= 0;
+    fflush(W->f);
+}
+
+/* Format a decimal integer, returning the number of characters written. */
+static inline int
+format_int(char *p, int32_t v) {
+    char tmp[12];
+    uint32_t u= v < 0 ? -(uint32_t)v : (uint32_t)v;
+    int i= 0, n= 0;
+
+    do {
+        tmp[i++]= '0' + u % 10;
+        u/= 10;
+    } while(u);
+
+    if(v < 0) p[n++]= '-';
+    while(i > 0) p[n++]= tmp[--i];
+
+    return n;
+}
+
+void
+smp_write(smp_writer_t *W, int32_t in, int32_t out) {
+    assert(W);
+
+    if(W->fill + MAX_TEXT_REC > OUT_BUF) smp_flush(W);
+
+    if(W->binary) {
+        smp_t s= { .in= in, .out= out };
+
+        memcpy(W->buf + W->fill, &s, sizeof(smp_t));
+        W->fill+= sizeof(smp_t);
+    }
+    else {
+        W->fill+= format_int(W->buf + W->fill, in);
+        W->buf[W->fill++]= ' ';
+        W->fill+= format_int(W->buf + W->fill, out);
+        W->buf[W->fill++]= '\n';
+    }
+}
+
+void
+smp_writer_destroy(smp_writer_t *W) {
+    assert(W);
+    smp_flush(W);
+    free(W->buf);
+    free(W);
+}
@@ -0,0 +1,93 @@
+/* samples.h
+
+   Streaming input and output of "input output" sample pairs, in either the
+   traditional text format, or a compact fixed-width binary format.
+
+   This code is experimental, and error-handling is primitive.
+*/
+
+/* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
+
+#ifndef __SAMPLES_H
+#define __SAMPLES_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*** Binary Sample Format ***/
+
+/* A binary sample stream is a header, followed by a packed array of
+ * little-endian (input, output) pairs.  The header is a multiple of the
+ * record size, so streams can be concatenated (e.g. by xzcat) - a header
+ * appearing mid-stream is recognised and skipped. */
+
+#define SMP_VERSION 1
+#define SMP_MAGIC "SAMPLEPAIRLE"
+#define SMP_MAGIC_LEN 12
+
+typedef struct smp_header {
+    char magic[SMP_MAGIC_LEN];
+    int32_t ver;     /* Version. */
+    int32_t flags;   /* Reserved, must be zero. */
+    int32_t recsize; /* Size of a single record, sizeof(smp_t). */
+} smp_header_t;
+
+/* A single sample. */
+typedef struct smp {
+    int32_t in;      /* Input (modulation), the matrix row. */
+    int32_t out;     /* Observed output, the matrix column. */
+} smp_t;
+
+/*** Readers ***/
+
+/* Samples per batch returned by smp_read. */
+#define SMP_BATCH (1 << 16)
+
+typedef struct smp_reader {
+    FILE *f;
+    int binary;      /* Binary (1) or text (0) input, autodetected. */
+    int eof;
+
+    /* Raw input, either a private buffer or a mapping of the whole file. */
+    char *buf;
+    size_t buf_size;
+    size_t start, end;  /* Unconsumed bytes are buf[start,end). */
+    int mapped;
+
+    /* Decoded samples, for text input. */
+    smp_t *batch;
+
+    size_t nread;     /* Samples read so far. */
+    size_t malformed; /* Text lines that didn't parse. */
+} smp_reader_t;
+
+/* Open a sample stream on f (which may be a pipe).  Regular files are
+ * mapped, other streams are read in large blocks.  The format is detected
+ * from the first bytes of the stream. */
+smp_reader_t *smp_reader_new(FILE *f);
+/* Destroy, without closing the underlying FILE. */
+void smp_reader_destroy(smp_reader_t *R);
+/* Return the next batch of samples in *batch, and their number.  The batch
+ * is valid until the next call.  Returns 0 at end of stream. */
+size_t smp_read(smp_reader_t *R, const smp_t **batch);
+
+/*** Writers ***/
+
+typedef struct smp_writer {
+    FILE *f;
+    int binary;
+    char *buf;
+    size_t fill;
+} smp_writer_t;
+
+/* Start a (binary or text) sample stream on f.  Binary streams begin with a
+ * header. */
+smp_writer_t *smp_writer_new(FILE *f, int binary);
+/* Append a sample. */
+void smp_write(smp_writer_t *W, int32_t in, int32_t out);
+/* Push buffered samples through to the underlying FILE. */
+void smp_flush(smp_writer_t *W);
+/* Flush and destroy, without closing the underlying FILE. */
+void smp_writer_destroy(smp_writer_t *W);
+
+#endif /* __SAMPLES_H */
@@ -0,0 +1,224 @@
+/* sampling.c
+
+   Drawing simulated channel matrices from known output distributions.
+
+   This code is experimental, and error-handling is primitive.
+*/
+
+/* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
+
+#include <assert.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sampling.h"
+
+struct alias *
+alias_new(dv_t *p) {
+    struct alias *A;
+    double *scaled, Ps= 0.0;
+    int *small, *large;
+    int ns= 0, nl= 0, i;
+
+    A= malloc(sizeof(struct alias));
+    if(!A) { perror("malloc"); abort(); }
+    A->n= p->length;
+    A->prob= malloc(A->n * sizeof(float));
+    A->alias= malloc(A->n * sizeof(int));
+    scaled= malloc(A->n * sizeof(double));
+    small= malloc(A->n * sizeof(int));
+    large= malloc(A->n * sizeof(int));
+    if(!A->prob || !A->alias || !scaled || !small || !large) {
+        perror("malloc");
+        abort();
+    }
+
+    for(i= 0; i < A->n; i++) Ps+= p->entries[i];
+
+    /* Split the columns into those with less than the average probability,
+     * and those with more. */
+    for(i= 0; i < A->n; i++) {
+        scaled[i]= p->entries[i] * A->n / Ps;
+        if(scaled[i] < 1.0) small[ns++]= i;
+        else                large[nl++]= i;
+    }
+
+    /* Top up each small column from a large one. */
+    while(ns > 0 && nl > 0) {
+        int s= small[--ns], l= large[nl-1];
+
+        A->prob[s]= scaled[s];
+        A->alias[s]= l;
+        scaled[l]-= 1.0 - scaled[s];
+        if(scaled[l] < 1.0) {
+            nl--;
+            small[ns++]= l;
+        }
+    }
+
+    /* Whatever is left is full, up to rounding. */
+    while(nl > 0) {
+        int l= large[--nl];
+        A->prob[l]= 1.0;
+        A->alias[l]= l;
+    }
+    while(ns > 0) {
+        int s= small[--ns];
+        A->prob[s]= 1.0;
+        A->alias[s]= s;
+    }
+
+    free(large);
+    free(small);
+    free(scaled);
+
+    return A;
+}
+
+void
+alias_destroy(struct alias *A) {
+    free(A->alias);
+    free(A->prob);
+    free(A);
+}
+
+struct sampler *
+sampler_new(int rows, int samples, int ncol) {
+    struct sampler *S;
+    int64_t n= (int64_t)rows * samples;
+    int r;
+
+    S= calloc(1, sizeof(struct sampler));
+    if(!S) { perror("calloc"); abort(); }
+    S->rows= rows;
+    S->samples= samples;
+    S->ncol= ncol;
+
+    S->draws= malloc(n * sizeof(int));
+    S->col_start= malloc((ncol + 1) * sizeof(int));
+    S->sorted= malloc(n * sizeof(int));
+    if(!S->draws || !S->col_start || !S->sorted) {
+        perror("malloc");
+        abort();
+    }
+
+    S->M.ver= CSC_VERSION;
+    S->M.flags= 0;
+    S->M.nrow= rows;
+    S->M.ci= memalign(64, (ncol + 1) * sizeof(int));
+    S->M.rows= memalign(64, n * sizeof(int));
+    S->M.entries= memalign(64, n * sizeof(float));
+    S->M.row_size= memalign(64, rows * sizeof(uint32_t));
+    if(!S->M.ci || !S->M.rows || !S->M.entries || !S->M.row_size) {
+        perror("memalign");
+        abort();
+    }
+
+    /* Every row is drawn the same number of times. */
+    for(r= 0; r < rows; r++) S->M.row_size[r]= samples;
+
+    return S;
+}
+
+void
+sampler_destroy(struct sampler *S) {
+    free(S->M.row_size);
+    free(S->M.entries);
+    free(S->M.rows);
+    free(S->M.ci);
+    free(S->sorted);
+    free(S->col_start);
+    free(S->draws);
+    free(S);
+}
+
+csc_mat_t *
+sampled_matrix(struct sampler *S, struct alias *la, struct alias *ra,
+               dsfmt_t *rng) {
+    csc_mat_t *M= &S->M;
+    int64_t i;
+    float scale= 1.0 / S->samples;
+    int r, c;
+
+    assert(la->n == S->ncol && ra->n == S->ncol);
+
+    /* Draw the samples, and count them by column. */
+    memset(S->col_start, 0, (S->ncol + 1) * sizeof(int));
+    for(r= 0, i= 0; r < S->rows; r++) {
+        struct alias *A= r < S->rows/2 ? la : ra;
+        int k;
+
+        for(k= 0; k < S->samples; k++, i++) {
+            S->draws[i]= alias_sample(A, rng);
+            S->col_start[S->draws[i] + 1]++;
+        }
+    }
+    for(c= 0; c < S->ncol; c++) S->col_start[c+1]+= S->col_start[c];
+
+    /* Bucket the rows by column.  We visit rows in order, so each column's
+     * rows come out sorted. */
+    for(r= 0, i= 0; r < S->rows; r++) {
+        int k;
+
+        for(k= 0; k < S->samples; k++, i++)
+            S->sorted[S->col_start[S->draws[i]]++]= r;
+    }
+
+    /* Merge repeated rows into counts.  Every row has the same total, so
+     * normalising is just scaling.  Empty columns are dropped, as the ABA
+     * doesn't like them. */
+    M->ncol= 0;
+    M->nnz= 0;
+    for(c= 0, i= 0; c < S->ncol; c++) {
+        int64_t end= S->col_start[c];
+
+        if(i == end) continue;
+
+        M->ci[M->ncol++]= M->nnz;
+        while(i < end) {
+            int row= S->sorted[i], count= 0;
+
+            while(i < end && S->sorted[i] == row) { count++; i++; }
+
+            M->rows[M->nnz]= row;
+            M->entries[M->nnz]= count * scale;
+            M->nnz++;
+        }
+    }
+    M->ci[M->ncol]= M->nnz;
+    assert(csc_check(M, 1));
+
+    return M;
+}
+
+/* Average along the columns of the matrix. */
+dv_t *
+average_cols(csc_mat_t *M) {
+    dv_t *v;
+    int c;
+    float Ps= 0.0;
+
+    v= dv_new(M->ncol);
+    if(!v) {
+        perror("dv_new");
+        exit(EXIT_FAILURE);
+    }
+    dv_zero(v);
+
+    for(c= 0; c < M->ncol; c++) {
+        int64_t i;
+
+        for(i= M->ci[c]; i < M->ci[c+1]; i++) {
+            if(M->entries[i] == 0) continue;
+            v->entries[c]+= M->entries[i];
+        }
+    }
+
+    /* Rescale to ensure total prob = 1, each entry contains the prob of seeing the colunm value given all the total number of colunm values*/
+    for(c= 0; c < v->length; c++) Ps+= v->entries[c];
+    for(c= 0; c < v->length; c++) v->entries[c]/= Ps;
+
+    return v;
+}
@@ -0,0 +1,64 @@
+/* sampling.h
+
+   Drawing simulated channel matrices from known output distributions.
+
+   This code is experimental, and error-handling is primitive.
+*/
+
+/* Copyright 2013, NICTA.  See COPYRIGHT for license details. */
+
+#ifndef __SAMPLING_H
+#define __SAMPLING_H
+
+#include "sparse.h"
+#include "dSFMT-src-2.2.1/dSFMT.h"
+
+/* Walker's alias table, for drawing from a discrete distribution in
+ * constant time. */
+struct alias {
+    int n;
+    float *prob;  /* Probability of keeping the column itself... */
+    int *alias;   /* ...rather than taking its alias. */
+};
+
+/* Build the alias table for p (Vose's method). */
+struct alias *alias_new(dv_t *p);
+void alias_destroy(struct alias *A);
+
+/* Sample a column from the given distribution. */
+static inline int
+alias_sample(struct alias *A, dsfmt_t *rng) {
+    /* One draw picks both the column and the coin. */
+    double x= dsfmt_genrand_close_open(rng) * A->n;
+    int c= (int)x;
+
+    if(x - c < A->prob[c]) return c;
+    else                   return A->alias[c];
+}
+
+/* A worker's buffers for building sampled matrices.  The largest possible
+ * matrix has one entry per sample, so everything is allocated once, and
+ * the matrix is rebuilt in place for every job. */
+struct sampler {
+    int rows, samples, ncol;
+    int *draws;      /* Column of each sample, by row. */
+    int *col_start;  /* Counting-sort buckets, by column. */
+    int *sorted;     /* Sample rows, sorted by column. */
+    csc_mat_t M;     /* Points into the above. */
+};
+
+struct sampler *sampler_new(int rows, int samples, int ncol);
+void sampler_destroy(struct sampler *S);
+
+/* Generate a matrix by taking 'samples' samples per row from the given
+ * distributions, using la for the top half of the rows and ra for the
+ * bottom.  The result is normalised, without empty columns, and is owned
+ * by S: it's only valid until the next call. */
+csc_mat_t *sampled_matrix(struct sampler *S, struct alias *la,
+                          struct alias *ra, dsfmt_t *rng);
+
+/* Average along the columns of the matrix, giving the output distribution
+ * for uniform input. */
+dv_t *average_cols(csc_mat_t *M);
+
+#endif /* __SAMPLING_H */
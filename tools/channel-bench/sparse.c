@@ -17,7 +17,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "kernels.h"
 #include "sparse.h"
 
 #undef DEBUG_SPARSE
@@ -185,6 +189,524 @@ bsc_hist_count(bsc_hist_t *H, int c, int r, int n) {
     H->row_total[r]+= n;
 }
 
+/* Parallel build worker.  Counts this worker's queue of each chunk. */
+struct bsc_par_arg {
+    bsc_par_t *P;
+    int i;
+};
+
+static void *
+bsc_par_worker(void *_arg) {
+    struct bsc_par_arg *arg= (struct bsc_par_arg *)_arg;
+    bsc_par_t *P= arg->P;
+    bsc_hist_t *H= P->shards[arg->i];
+    int i= arg->i;
+
+    free(arg);
+
+    while(1) {
+        int32_t *chunk;
+        size_t j, len;
+
+        pthread_barrier_wait(&P->go);
+        if(P->quit) break;
+
+        chunk= P->chunk[P->active][i];
+        len= P->fill[P->active][i];
+        for(j= 0; j < len; j++) bsc_hist_count(H, chunk[2*j], chunk[2*j+1], 1);
+
+        pthread_barrier_wait(&P->done);
+    }
+
+    return NULL;
+}
+
+/* Start a parallel build. */
+bsc_par_t *
+bsc_par_new(int n) {
+    bsc_par_t *P;
+    int i, b;
+
+    assert(0 < n);
+
+    P= (bsc_par_t *)calloc(1, sizeof(bsc_par_t));
+    if(!P) { perror("calloc"); abort(); }
+
+    P->nthreads= n;
+    P->qlen= BSC_PAR_CHUNK / n;
+    P->threads= malloc(n * sizeof(pthread_t));
+    P->shards= malloc(n * sizeof(bsc_hist_t *));
+    if(!P->threads || !P->shards) { perror("malloc"); abort(); }
+
+    for(b= 0; b < 2; b++) {
+        P->chunk[b]= malloc(n * sizeof(int32_t *));
+        P->fill[b]= calloc(n, sizeof(size_t));
+        if(!P->chunk[b] || !P->fill[b]) { perror("malloc"); abort(); }
+
+        for(i= 0; i < n; i++) {
+            P->chunk[b][i]= malloc(2 * P->qlen * sizeof(int32_t));
+            if(!P->chunk[b][i]) { perror("malloc"); abort(); }
+        }
+    }
+
+    if(pthread_barrier_init(&P->go, NULL, n + 1) ||
+       pthread_barrier_init(&P->done, NULL, n + 1))
+        { perror("pthread_barrier_init"); abort(); }
+
+    for(i= 0; i < n; i++) {
+        struct bsc_par_arg *arg= malloc(sizeof(struct bsc_par_arg));
+        if(!arg) { perror("malloc"); abort(); }
+        arg->P= P;
+        arg->i= i;
+
+        P->shards[i]= bsc_hist_new();
+        if(pthread_create(&P->threads[i], NULL, bsc_par_worker, arg))
+            { perror("pthread_create"); abort(); }
+    }
+
+    return P;
+}
+
+/* Hand the current chunk to the workers, and start filling the other. */
+static void
+bsc_par_dispatch(bsc_par_t *P) {
+    if(P->inflight) pthread_barrier_wait(&P->done);
+
+    P->active= P->cur;
+    P->cur^= 1;
+    memset(P->fill[P->cur], 0, P->nthreads * sizeof(size_t));
+    P->pending= 0;
+    P->inflight= 1;
+
+    pthread_barrier_wait(&P->go);
+}
+
+void
+bsc_par_count(bsc_par_t *P, int c, int r) {
+    int w;
+    size_t i;
+
+    assert(P);
+    assert(0 <= c);
+    assert(0 <= r);
+
+    w= c % P->nthreads;
+    i= P->fill[P->cur][w]++;
+    P->chunk[P->cur][w][2*i]= c;
+    P->chunk[P->cur][w][2*i+1]= r;
+    P->pending++;
+
+    if(P->fill[P->cur][w] == P->qlen) bsc_par_dispatch(P);
+}
+
+/* Finish counting, and merge the (column-disjoint) shards. */
+bsc_hist_t *
+bsc_par_finish(bsc_par_t *P) {
+    bsc_hist_t *H;
+    int i, b, c, r;
+    int end_col= 0, end_row= 0;
+
+    assert(P);
+
+    if(P->pending > 0) bsc_par_dispatch(P);
+    if(P->inflight) pthread_barrier_wait(&P->done);
+
+    P->quit= 1;
+    pthread_barrier_wait(&P->go);
+    for(i= 0; i < P->nthreads; i++) {
+        if(pthread_join(P->threads[i], NULL))
+            { perror("pthread_join"); abort(); }
+    }
+
+    for(i= 0; i < P->nthreads; i++) {
+        if(P->shards[i]->end_col > end_col) end_col= P->shards[i]->end_col;
+        if(P->shards[i]->end_row > end_row) end_row= P->shards[i]->end_row;
+    }
+
+    H= bsc_hist_new();
+    if(end_col > 0) bsc_extend(H, end_col - 1);
+
+    H->end_row= end_row;
+    H->row_total= calloc(end_row, sizeof(int));
+    if(end_row > 0 && !H->row_total) { perror("calloc"); abort(); }
+
+    /* Steal each column from the shard that owns it. */
+    for(c= 0; c < end_col; c++) {
+        bsc_hist_t *S= P->shards[c % P->nthreads];
+
+        if(c >= S->end_col) continue;
+
+        H->start_rows[c]= S->start_rows[c];
+        H->end_rows[c]=   S->end_rows[c];
+        H->entries[c]=    S->entries[c];
+        S->entries[c]=    NULL;
+    }
+
+    for(i= 0; i < P->nthreads; i++) {
+        bsc_hist_t *S= P->shards[i];
+
+        for(r= 0; r < S->end_row; r++) H->row_total[r]+= S->row_total[r];
+        H->total+=  S->total;
+        H->nalloc+= S->nalloc;
+        H->nnz+=    S->nnz;
+
+        bsc_hist_destroy(S);
+    }
+
+    pthread_barrier_destroy(&P->go);
+    pthread_barrier_destroy(&P->done);
+    for(b= 0; b < 2; b++) {
+        for(i= 0; i < P->nthreads; i++) free(P->chunk[b][i]);
+        free(P->chunk[b]);
+        free(P->fill[b]);
+    }
+    free(P->shards);
+    free(P->threads);
+    free(P);
+
+    return H;
+}
+
+/* The smallest buffer worth spilling, in samples. */
+#define BSC_EXT_MIN (1 << 16)
+/* Triples read from each run at a time, while merging. */
+#define BSC_EXT_READ 4096
+/* The most runs merged (and so open) at once, per level. */
+#define BSC_EXT_FANIN 16
+
+/* A spilled (column,row,count) triple. */
+struct bsc_triple {
+    int32_t c, r, n;
+};
+
+bsc_ext_t *
+bsc_ext_new(size_t budget, const char *dir) {
+    bsc_ext_t *X;
+
+    X= (bsc_ext_t *)calloc(1, sizeof(bsc_ext_t));
+    if(!X) { perror("calloc"); abort(); }
+
+    if(!dir) dir= getenv("TMPDIR");
+    if(!dir || !*dir) dir= "/tmp";
+    X->dir= strdup(dir);
+    if(!X->dir) { perror("strdup"); abort(); }
+
+    X->size= budget / sizeof(uint64_t);
+    if(X->size < BSC_EXT_MIN) X->size= BSC_EXT_MIN;
+    X->buf= malloc(X->size * sizeof(uint64_t));
+    if(!X->buf) { perror("malloc"); abort(); }
+
+    return X;
+}
+
+static int
+cmp_key(const void *a, const void *b) {
+    uint64_t x= *(const uint64_t *)a, y= *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Create an (already unlinked) file for a run. */
+static FILE *
+bsc_ext_tmpfile(bsc_ext_t *X) {
+    char *path;
+    int fd;
+    FILE *f;
+
+    path= malloc(strlen(X->dir) + 16);
+    if(!path) { perror("malloc"); abort(); }
+    sprintf(path, "%s/bsc_run.XXXXXX", X->dir);
+    fd= mkstemp(path);
+    if(fd < 0) { perror(path); abort(); }
+    unlink(path);
+    free(path);
+
+    f= fdopen(fd, "w+b");
+    if(!f) { perror("fdopen"); abort(); }
+
+    return f;
+}
+
+static void bsc_ext_combine(bsc_ext_t *X);
+
+/* Sort the buffer, and write it out as a run of triples. */
+static void
+bsc_ext_spill(bsc_ext_t *X) {
+    struct bsc_triple t[BSC_EXT_READ];
+    size_t i= 0;
+    int n= 0;
+    FILE *f;
+
+    if(X->fill == 0) return;
+
+    qsort(X->buf, X->fill, sizeof(uint64_t), cmp_key);
+
+    f= bsc_ext_tmpfile(X);
+
+    while(i < X->fill) {
+        uint64_t k= X->buf[i];
+        int32_t count= 0;
+
+        while(i < X->fill && X->buf[i] == k) { count++; i++; }
+
+        t[n].c= k >> 32;
+        t[n].r= k & 0xffffffff;
+        t[n].n= count;
+        if(++n == BSC_EXT_READ) {
+            if(fwrite(t, sizeof(struct bsc_triple), n, f) != n)
+                { perror("fwrite"); abort(); }
+            n= 0;
+        }
+    }
+    if(n > 0 && fwrite(t, sizeof(struct bsc_triple), n, f) != n)
+        { perror("fwrite"); abort(); }
+    if(fflush(f)) { perror("fflush"); abort(); }
+
+    X->runs= realloc(X->runs, (X->nruns + 1) * sizeof(FILE *));
+    X->levels= realloc(X->levels, (X->nruns + 1) * sizeof(int));
+    if(!X->runs || !X->levels) { perror("realloc"); abort(); }
+    X->runs[X->nruns]= f;
+    X->levels[X->nruns]= 0;
+    X->nruns++;
+    X->fill= 0;
+
+    /* Merge full levels, so that few runs are ever open. */
+    while(X->nruns >= BSC_EXT_FANIN &&
+          X->levels[X->nruns - BSC_EXT_FANIN] == X->levels[X->nruns - 1])
+        bsc_ext_combine(X);
+}
+
+void
+bsc_ext_count(bsc_ext_t *X, int c, int r) {
+    assert(X);
+    assert(0 <= c);
+    assert(0 <= r);
+
+    if(r >= X->end_row) {
+        X->row_total= (int *)realloc(X->row_total, (r+1) * sizeof(int));
+        if(!X->row_total) { perror("realloc"); abort(); }
+        memset(X->row_total + X->end_row, 0,
+                (r+1 - X->end_row) * sizeof(int));
+        X->end_row= r + 1;
+    }
+    if(c >= X->end_col) X->end_col= c + 1;
+
+    X->row_total[r]++;
+    X->total++;
+
+    X->buf[X->fill++]= ((uint64_t)c << 32) | (uint32_t)r;
+    if(X->fill == X->size) bsc_ext_spill(X);
+}
+
+/* A buffered reader over one run. */
+struct bsc_cursor {
+    FILE *f;
+    struct bsc_triple *t;
+    size_t i, n;
+    uint64_t key;       /* Key of t[i], or UINT64_MAX once exhausted. */
+};
+
+static void
+cursor_next(struct bsc_cursor *C) {
+    if(++C->i >= C->n) {
+        C->n= fread(C->t, sizeof(struct bsc_triple), BSC_EXT_READ, C->f);
+        if(ferror(C->f)) { perror("fread"); abort(); }
+        C->i= 0;
+    }
+    if(C->i < C->n)
+        C->key= ((uint64_t)C->t[C->i].c << 32) | (uint32_t)C->t[C->i].r;
+    else
+        C->key= UINT64_MAX;
+}
+
+static void
+cursor_rewind(struct bsc_cursor *C) {
+    if(fseek(C->f, 0, SEEK_SET)) { perror("fseek"); abort(); }
+    C->n= 0;
+    C->i= 0;
+    cursor_next(C);
+}
+
+/* Restore the heap property below position i, for a heap of cursors
+ * ordered by key. */
+static void
+heap_down(struct bsc_cursor **h, int n, int i) {
+    while(1) {
+        int l= 2*i + 1, m= i;
+
+        if(l < n && h[l]->key < h[m]->key) m= l;
+        if(l + 1 < n && h[l+1]->key < h[m]->key) m= l + 1;
+        if(m == i) return;
+
+        { struct bsc_cursor *t= h[i]; h[i]= h[m]; h[m]= t; }
+        i= m;
+    }
+}
+
+/* Merge n runs in (column,row) order, summing the counts of repeated
+ * entries.  With an output file, write the result as a new run.  Otherwise,
+ * if M has no arrays yet, just count the entries, else fill them in. */
+static void
+bsc_ext_merge(bsc_ext_t *X, struct bsc_cursor *cur, struct bsc_cursor **h,
+              int n, csc_mat_t *M, FILE *out) {
+    struct bsc_triple t[BSC_EXT_READ];
+    int i, m= 0;
+    int c= 0;
+    int64_t nnz= 0;
+
+    for(i= 0; i < n; i++) {
+        cursor_rewind(&cur[i]);
+        h[i]= &cur[i];
+    }
+    for(i= n/2 - 1; i >= 0; i--) heap_down(h, n, i);
+
+    while(n > 0 && h[0]->key != UINT64_MAX) {
+        uint64_t k= h[0]->key;
+        int32_t col= k >> 32, row= k & 0xffffffff;
+        int count= 0;
+
+        /* Sum this entry over every run that has it. */
+        while(h[0]->key == k) {
+            count+= h[0]->t[h[0]->i].n;
+            cursor_next(h[0]);
+            heap_down(h, n, 0);
+        }
+
+        if(out) {
+            t[m].c= col;
+            t[m].r= row;
+            t[m].n= count;
+            if(++m == BSC_EXT_READ) {
+                if(fwrite(t, sizeof(struct bsc_triple), m, out) != m)
+                    { perror("fwrite"); abort(); }
+                m= 0;
+            }
+        }
+        else if(M->ci) {
+            /* Columns without entries start (and end) here. */
+            for(; c <= col; c++) M->ci[c]= nnz;
+            M->rows[nnz]= row;
+            M->entries[nnz]= (float)count / X->row_total[row];
+        }
+        nnz++;
+    }
+
+    if(out) {
+        if(m > 0 && fwrite(t, sizeof(struct bsc_triple), m, out) != m)
+            { perror("fwrite"); abort(); }
+        if(fflush(out)) { perror("fflush"); abort(); }
+        return;
+    }
+
+    if(M->ci) {
+        for(; c <= M->ncol; c++) M->ci[c]= nnz;
+    }
+    M->nnz= nnz;
+}
+
+/* Cursors (and a heap) over n runs. */
+static struct bsc_cursor *
+cursors_new(FILE **runs, int n, struct bsc_cursor ***h) {
+    struct bsc_cursor *cur;
+    int i;
+
+    cur= calloc(n, sizeof(struct bsc_cursor));
+    *h= malloc(n * sizeof(struct bsc_cursor *));
+    if(n > 0 && (!cur || !*h)) { perror("malloc"); abort(); }
+    for(i= 0; i < n; i++) {
+        cur[i].f= runs[i];
+        cur[i].t= malloc(BSC_EXT_READ * sizeof(struct bsc_triple));
+        if(!cur[i].t) { perror("malloc"); abort(); }
+    }
+
+    return cur;
+}
+
+/* Close the runs, and free the cursors. */
+static void
+cursors_destroy(struct bsc_cursor *cur, int n, struct bsc_cursor **h) {
+    int i;
+
+    for(i= 0; i < n; i++) {
+        fclose(cur[i].f);
+        free(cur[i].t);
+    }
+    free(cur);
+    free(h);
+}
+
+/* Merge the last BSC_EXT_FANIN runs into one, a level above the highest. */
+static void
+bsc_ext_combine(bsc_ext_t *X) {
+    struct bsc_cursor *cur, **h;
+    int first= X->nruns - BSC_EXT_FANIN, level= 0, i;
+    FILE *f;
+
+    assert(first >= 0);
+
+    for(i= first; i < X->nruns; i++)
+        if(X->levels[i] > level) level= X->levels[i];
+
+    f= bsc_ext_tmpfile(X);
+    cur= cursors_new(X->runs + first, BSC_EXT_FANIN, &h);
+    bsc_ext_merge(X, cur, h, BSC_EXT_FANIN, NULL, f);
+    cursors_destroy(cur, BSC_EXT_FANIN, h);
+
+    X->runs[first]= f;
+    X->levels[first]= level + 1;
+    X->nruns= first + 1;
+}
+
+csc_mat_t *
+bsc_ext_finish(bsc_ext_t *X) {
+    struct bsc_cursor *cur, **h;
+    csc_mat_t *M;
+
+    assert(X);
+
+    bsc_ext_spill(X);
+    free(X->buf);
+    X->buf= NULL;
+
+    /* Runs are left over from each level, so merge the newest (smallest)
+     * until the rest can be merged at once. */
+    while(X->nruns > BSC_EXT_FANIN) bsc_ext_combine(X);
+
+    cur= cursors_new(X->runs, X->nruns, &h);
+
+    M= (csc_mat_t *)calloc(1, sizeof(csc_mat_t));
+    if(!M) { perror("calloc"); abort(); }
+    M->ver= CSC_VERSION;
+    M->flags= 0; /* No stride. */
+    M->nrow= X->end_row;
+    M->ncol= X->end_col;
+
+    /* Count the entries first, so that the matrix can be allocated
+     * exactly... */
+    bsc_ext_merge(X, cur, h, X->nruns, M, NULL);
+
+    M->ci=   memalign(64, (M->ncol + 1) * sizeof(int));
+    if(!M->ci) { perror("malloc"); abort(); }
+    M->rows= memalign(64, M->nnz * sizeof(int));
+    if(!M->rows) { perror("malloc"); abort(); }
+    M->entries= memalign(64, M->nnz * sizeof(float));
+    if(!M->entries) { perror("malloc"); abort(); }
+    M->row_size= memalign(64, M->nrow * sizeof(uint32_t));
+    if(!M->row_size) { perror("malloc"); abort(); }
+    memcpy(M->row_size, X->row_total, M->nrow * sizeof(uint32_t));
+
+    /* ...then fill it in. */
+    bsc_ext_merge(X, cur, h, X->nruns, M, NULL);
+
+    cursors_destroy(cur, X->nruns, h);
+    free(X->runs);
+    free(X->levels);
+    free(X->row_total);
+    free(X->dir);
+    free(X);
+
+    return M;
+}
+
 /* Normalize a histogram, to give a conditional probability matrix. */
 csc_mat_t *
 bsc_normalise(bsc_hist_t *H) {
@@ -457,10 +979,24 @@ csc_size(csc_mat_t *M) {
     }
 }
 
+/* Is p within the mapping backing M? */
+static int
+csc_in_map(csc_mat_t *M, void *p) {
+    return M->map && (char *)M->map <= (char *)p &&
+           (char *)p < (char *)M->map + M->map_len;
+}
+
 /* Deallocate matrix. */
 void
 csc_mat_destroy(csc_mat_t *M) {
     assert(M);
+    if(M->map) {
+        /* Only the column index can have been copied, by pruning. */
+        if(M->ci && !csc_in_map(M, M->ci)) free(M->ci);
+        if(munmap(M->map, M->map_len)) { perror("munmap"); abort(); }
+        free(M);
+        return;
+    }
     if(STRIDE_OF(M) > 1) {
         assert(M->si);
         free(M->si);
@@ -491,6 +1027,7 @@ static const char *csc_errstr[] = {
     "File truncated",
     "Bad magic bytes",
     "System error - check errno",
+    "Unsupported version",
 };
 
 /* Readable errors. */
@@ -502,11 +1039,56 @@ csc_perror(csc_errno_t e, const char *s) {
     else fprintf(stderr, "%s: %s\n", s, csc_errstr[e]);
 }
 
+/* Padding required to align offset off to a section boundary. */
+static inline uint64_t
+csc_section_pad(uint64_t off) {
+    return ROUND_UP(off, CSC_SECTION_ALIGN) - off;
+}
+
+/* Write a section of n elements, aligned to a section boundary.  off
+ * tracks the file offset, as f need not be seekable. */
+static int
+csc_write_section(FILE *f, const void *p, size_t size, size_t n,
+                  uint64_t *off) {
+    static const char zeroes[CSC_SECTION_ALIGN];
+    uint64_t pad= csc_section_pad(*off);
+
+    if(fwrite(zeroes, 1, pad, f) != pad) return 0;
+    if(fwrite(p, size, n, f) != n) return 0;
+    *off+= pad + size * n;
+
+    return 1;
+}
+
+/* Read a section of n elements, skipping any alignment padding in version
+ * 2 files.  Returns the number of elements read. */
+static size_t
+csc_read_section(FILE *f, void *p, size_t size, size_t n, int32_t ver,
+                 uint64_t *off) {
+    char pad_buf[CSC_SECTION_ALIGN];
+    size_t r;
+
+    if(ver >= 2) {
+        uint64_t pad= csc_section_pad(*off);
+
+        if(fread(pad_buf, 1, pad, f) != pad) return 0;
+        *off+= pad;
+    }
+
+    r= fread(p, size, n, f);
+    *off+= size * r;
+
+    return r;
+}
+
 /* Serialise into FD f */
 csc_errno_t
 csc_store_binary(csc_mat_t *M, FILE *f) {
+    int32_t ver= CSC_VERSION;
+    uint64_t off= CSC_HEADER_LEN;
+
     if(fputs(CSC_MAGIC, f) == EOF) return E_CSC_ERRNO;
-    if(fwrite(&M->ver,    sizeof(int32_t), 1, f) != 1)
+    if(fwrite(&ver,       sizeof(int32_t), 1, f) != 1)
         return E_CSC_ERRNO;
     if(fwrite(&M->flags,  sizeof(int32_t), 1, f) != 1)
         return E_CSC_ERRNO;
@@ -517,28 +1099,28 @@ csc_store_binary(csc_mat_t *M, FILE *f) {
     if(fwrite(&M->nnz,    sizeof(int64_t), 1, f) != 1)
         return E_CSC_ERRNO;
     if(STRIDE_OF(M) > 1) {
-        if(fwrite(M->si, sizeof(int32_t),
-                  M->ncol/STRIDE_OF(M)+1, f) != M->ncol/STRIDE_OF(M)+1)
+        if(!csc_write_section(f, M->si, sizeof(int32_t),
+                              M->ncol/STRIDE_OF(M)+1, &off))
             return E_CSC_ERRNO;
         if(M->flags & CSC_F_CFREE) {
-            if(fwrite(M->row_offsets, sizeof(uint8_t), M->nnz, f) != M->nnz)
+            if(!csc_write_section(f, M->row_offsets, sizeof(uint8_t),
+                                  M->nnz, &off))
                 return E_CSC_ERRNO;
         }
         else {
-            if(fwrite(M->sc, sizeof(uint8_t), M->nnz, f) != M->nnz)
+            if(!csc_write_section(f, M->sc, sizeof(uint8_t), M->nnz, &off))
                 return E_CSC_ERRNO;
         }
     }
     else {
-        if(fwrite(M->ci, sizeof(int32_t), M->ncol+1, f) != M->ncol+1)
+        if(!csc_write_section(f, M->ci, sizeof(int32_t), M->ncol+1, &off))
             return E_CSC_ERRNO;
     }
-    if(fwrite(M->rows,    sizeof(int32_t), M->nnz, f) != M->nnz)
+    if(!csc_write_section(f, M->rows,     sizeof(int32_t), M->nnz,  &off))
         return E_CSC_ERRNO;
-    if(fwrite(M->entries, sizeof(float), M->nnz, f)   != M->nnz)
+    if(!csc_write_section(f, M->entries,  sizeof(float),   M->nnz,  &off))
         return E_CSC_ERRNO;
-
-    if (fwrite(M->row_size, sizeof (uint32_t), M->nrow, f) != M->nrow)
+    if(!csc_write_section(f, M->row_size, sizeof(uint32_t), M->nrow, &off))
         return E_CSC_ERRNO; 
 
     return E_CSC_SUCCESS;
@@ -549,13 +1131,15 @@ csc_mat_t *
 csc_load_binary(FILE *f, csc_errno_t *e) {
     csc_mat_t *M;
     size_t n;
-    char magic[12];
+    char magic[CSC_MAGIC_LEN];
+    uint64_t off= CSC_HEADER_LEN;
 
     /* Check for magic */
-    n= fread(magic, 1, 12, f);
+    n= fread(magic, 1, CSC_MAGIC_LEN, f);
     if(ferror(f)) { *e= E_CSC_ERRNO; return NULL; }
-    if(n < 12) { *e= E_CSC_TRUNC; return NULL; }
-    if(strncmp(magic, CSC_MAGIC, 12)) { *e= E_CSC_BADMAGIC; return NULL; }
+    if(n < CSC_MAGIC_LEN) { *e= E_CSC_TRUNC; return NULL; }
+    if(strncmp(magic, CSC_MAGIC, CSC_MAGIC_LEN))
+        { *e= E_CSC_BADMAGIC; return NULL; }
 
     /* Allocate root struct */
     M= (csc_mat_t *)calloc(1,sizeof(csc_mat_t));
@@ -574,6 +1158,8 @@ csc_load_binary(FILE *f, csc_errno_t *e) {
     n+= fread(&M->nnz,   sizeof(int64_t), 1, f);
     if(ferror(f)) { *e= E_CSC_ERRNO; return NULL; }
     if(n != 5) { free(M); *e= E_CSC_TRUNC; return NULL; }
+    if(M->ver < 1 || M->ver > CSC_VERSION)
+        { free(M); *e= E_CSC_BADVER; return NULL; }
 
     /* Allocate tables */
     M->rows= memalign(64, M->nnz * sizeof(int32_t));
@@ -609,20 +1195,26 @@ csc_load_binary(FILE *f, csc_errno_t *e) {
     /* Read tables */
     if(STRIDE_OF(M) > 1) {
         n= 0;
-        n+= fread(M->si, sizeof(int32_t), M->ncol/STRIDE_OF(M) + 1, f);
+        n+= csc_read_section(f, M->si, sizeof(int32_t),
+                             M->ncol/STRIDE_OF(M) + 1, M->ver, &off);
         if(ferror(f)) { *e= E_CSC_ERRNO; return NULL; }
         if(M->flags & CSC_F_CFREE) {
-            n+= fread(M->row_offsets, sizeof(uint8_t), M->nnz, f);
+            n+= csc_read_section(f, M->row_offsets, sizeof(uint8_t), M->nnz,
+                                 M->ver, &off);
         }
         else {
-            n+= fread(M->sc, sizeof(uint8_t), M->nnz, f);
+            n+= csc_read_section(f, M->sc, sizeof(uint8_t), M->nnz,
+                                 M->ver, &off);
         }
         if(ferror(f)) { *e= E_CSC_ERRNO; return NULL; }
-        n+= fread(M->rows, sizeof(int32_t), M->nnz, f);
+        n+= csc_read_section(f, M->rows, sizeof(int32_t), M->nnz,
+                             M->ver, &off);
         if(ferror(f)) { *e= E_CSC_ERRNO; return NULL; }
-        n+= fread(M->entries, sizeof(float),   M->nnz, f);
+        n+= csc_read_section(f, M->entries, sizeof(float), M->nnz,
+                             M->ver, &off);
         if(ferror(f)) { *e= E_CSC_ERRNO; return NULL; }
-        n += fread(M->row_size, sizeof(uint32_t),   M->nrow,      f);
+        n+= csc_read_section(f, M->row_size, sizeof(uint32_t), M->nrow,
+                             M->ver, &off);
         if(ferror(f)) { *e= E_CSC_ERRNO; return NULL; }
 
         if(n != M->ncol/STRIDE_OF(M) + 1 + 3 * M->nnz + M->nrow) {
@@ -633,13 +1225,17 @@ csc_load_binary(FILE *f, csc_errno_t *e) {
     }
     else {
         n= 0;
-        n+= fread(M->ci, sizeof(int32_t), M->ncol + 1, f);
+        n+= csc_read_section(f, M->ci, sizeof(int32_t), M->ncol + 1,
+                             M->ver, &off);
         if(ferror(f)) { *e= E_CSC_ERRNO; return NULL; }
-        n+= fread(M->rows,    sizeof(int32_t), M->nnz,      f);
+        n+= csc_read_section(f, M->rows, sizeof(int32_t), M->nnz,
+                             M->ver, &off);
         if(ferror(f)) { *e= E_CSC_ERRNO; return NULL; }
-        n+= fread(M->entries, sizeof(float),   M->nnz,      f);
+        n+= csc_read_section(f, M->entries, sizeof(float), M->nnz,
+                             M->ver, &off);
         if(ferror(f)) { *e= E_CSC_ERRNO; return NULL; }
-        n += fread(M->row_size, sizeof(uint32_t),   M->nrow,      f);
+        n+= csc_read_section(f, M->row_size, sizeof(uint32_t), M->nrow,
+                             M->ver, &off);
         if(ferror(f)) { *e= E_CSC_ERRNO; return NULL; }
  
         if(n != M->ncol+1 + 2 * M->nnz + M->nrow) {
@@ -651,6 +1247,98 @@ csc_load_binary(FILE *f, csc_errno_t *e) {
     return M;
 }
 
+/* Locate the next section of n elements in a mapping, or return NULL if it
+ * runs past the end. */
+static void *
+csc_map_section(csc_mat_t *M, size_t size, size_t n, uint64_t *off) {
+    void *p;
+
+    *off+= csc_section_pad(*off);
+    if(*off + size * n > M->map_len) return NULL;
+
+    p= (char *)M->map + *off;
+    *off+= size * n;
+
+    return p;
+}
+
+/* Map a version 2 matrix read-only, pointing the arrays into the
+ * mapping. */
+csc_mat_t *
+csc_map_binary(FILE *f, csc_errno_t *e) {
+    csc_mat_t *M;
+    struct stat st;
+    char *map;
+    int32_t ver;
+    uint64_t off= CSC_HEADER_LEN;
+    int ok;
+
+    /* Streams can't be mapped. */
+    if(fstat(fileno(f), &st) || !S_ISREG(st.st_mode) || ftello(f) != 0)
+        return csc_load_binary(f, e);
+
+    if(st.st_size < CSC_HEADER_LEN) { *e= E_CSC_TRUNC; return NULL; }
+
+    map= mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fileno(f), 0);
+    if(map == MAP_FAILED) { *e= E_CSC_ERRNO; return NULL; }
+
+    if(strncmp(map, CSC_MAGIC, CSC_MAGIC_LEN)) {
+        munmap(map, st.st_size);
+        *e= E_CSC_BADMAGIC; return NULL;
+    }
+
+    /* Older files don't have aligned sections. */
+    memcpy(&ver, map + CSC_MAGIC_LEN, sizeof(int32_t));
+    if(ver < 2) {
+        munmap(map, st.st_size);
+        return csc_load_binary(f, e);
+    }
+    if(ver > CSC_VERSION) {
+        munmap(map, st.st_size);
+        *e= E_CSC_BADVER; return NULL;
+    }
+
+    M= (csc_mat_t *)calloc(1,sizeof(csc_mat_t));
+    if(!M) { munmap(map, st.st_size); *e= E_CSC_ERRNO; return NULL; }
+    M->map= map;
+    M->map_len= st.st_size;
+
+    /* Header */
+    memcpy(&M->ver,   map + CSC_MAGIC_LEN,      sizeof(int32_t));
+    memcpy(&M->flags, map + CSC_MAGIC_LEN + 4,  sizeof(int32_t));
+    memcpy(&M->nrow,  map + CSC_MAGIC_LEN + 8,  sizeof(int32_t));
+    memcpy(&M->ncol,  map + CSC_MAGIC_LEN + 12, sizeof(int32_t));
+    memcpy(&M->nnz,   map + CSC_MAGIC_LEN + 16, sizeof(int64_t));
+
+    /* Tables */
+    if(STRIDE_OF(M) > 1) {
+        M->si= csc_map_section(M, sizeof(int32_t),
+                               M->ncol/STRIDE_OF(M) + 1, &off);
+        if(M->flags & CSC_F_CFREE)
+            M->row_offsets= csc_map_section(M, sizeof(uint8_t), M->nnz,
+                                            &off);
+        else
+            M->sc= csc_map_section(M, sizeof(uint8_t), M->nnz, &off);
+        ok= M->si && (M->row_offsets || M->sc);
+    }
+    else {
+        M->ci= csc_map_section(M, sizeof(int32_t), M->ncol + 1, &off);
+        ok= M->ci != NULL;
+    }
+    M->rows=     csc_map_section(M, sizeof(int32_t),  M->nnz,  &off);
+    M->entries=  csc_map_section(M, sizeof(float),    M->nnz,  &off);
+    M->row_size= csc_map_section(M, sizeof(uint32_t), M->nrow, &off);
+
+    if(!ok || !M->rows || !M->entries || !M->row_size) {
+        munmap(map, st.st_size); free(M);
+        *e= E_CSC_TRUNC; return NULL;
+    }
+
+    madvise(map, st.st_size, MADV_WILLNEED);
+
+    return M;
+}
+
 /* Prune (remove) empty columns. */
 void
 csc_prune_cols(csc_mat_t *M) {
@@ -658,6 +1346,14 @@ csc_prune_cols(csc_mat_t *M) {
 
     assert(STRIDE_OF(M) == 1);
 
+    /* A mapped matrix gets a private copy of its column index. */
+    if(csc_in_map(M, M->ci)) {
+        int32_t *ci= malloc((M->ncol+1) * sizeof(int32_t));
+        if(!ci) { perror("malloc"); abort(); }
+        memcpy(ci, M->ci, (M->ncol+1) * sizeof(int32_t));
+        M->ci= ci;
+    }
+
     c_new= 0;
     for(c_old= 0; c_old < M->ncol; c_old++) {
         /* Only preserve nonempty columns. */
@@ -832,6 +1528,9 @@ csc_mult_cf(dv_t *y, dv_t *x, csc_mat_t *A) {
     }
 #endif
 
+    /* Vectorised kernels handle the common strides. */
+    if(kern_mult_cf(y, x, A)) return;
+
     stride= STRIDE_OF(A);
 
     dv_zero(y);
@@ -981,6 +1680,7 @@ csc_stride(csc_mat_t *M, int r_stride) {
     assert(M);
     assert(0 <= r_stride && r_stride <= CSC_MAX_STRIDE);
     assert(STRIDE_OF(M) == 1);
+    assert(!M->map);
 
     /* Set the stride. */
     M->flags &= ~CSC_M_STRIDERADIX;
@@ -1060,6 +1760,7 @@ csc_make_cfree(csc_mat_t *M, int row_span) {
     int s, i, block_index;
 
     assert(M);
+    assert(!M->map);
 
     /* Nothing to do. */
     if(STRIDE_OF(M) == 1 || M->flags & CSC_F_CFREE) return;
@@ -1156,6 +1857,7 @@ csc_align(csc_mat_t *M, int n) {
 
     assert(STRIDE_OF(M) == 1);
     assert(0 < n);
+    assert(!M->map);
 
     nnz_new= 0;
     for(c= 0; c < M->ncol; c++) {
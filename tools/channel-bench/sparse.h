@@ -12,6 +12,7 @@
 #ifndef __SPARSE_H
 #define __SPARSE_H
 
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -37,12 +38,64 @@ typedef struct bsc_hist {
     int64_t nnz;     /* Number of non-zero entries. */
 } bsc_hist_t;
 
+/* Samples per chunk handed to the workers of a parallel build, split
+ * evenly between the workers' queues. */
+#define BSC_PAR_CHUNK (1 << 20)
+
+/* Parallel BSC histogram builder.  Each worker owns an interleaved subset of
+ * columns, and the producer queues each sample only for its owner, so every
+ * worker reads just its own samples into a private shard.  As shards share
+ * no columns, merging them just moves the column arrays, and the result is
+ * identical to counting the same stream serially.  The next chunk is filled
+ * while the workers count the last, and is handed over as soon as any one
+ * worker's queue fills. */
+typedef struct bsc_par {
+    int nthreads;
+    pthread_t *threads;
+    bsc_hist_t **shards;    /* One per worker. */
+    pthread_barrier_t go;   /* Workers start a chunk (or quit). */
+    pthread_barrier_t done; /* Workers have finished a chunk. */
+    int32_t **chunk[2];     /* Double-buffered (column,row) pairs, per worker. */
+    size_t *fill[2];
+    size_t qlen;            /* Pairs per worker queue. */
+    size_t pending;         /* Pairs queued in the chunk being filled. */
+    int cur;                /* Chunk being filled. */
+    int active;             /* Chunk being counted. */
+    int inflight;
+    int quit;
+} bsc_par_t;
+
+/* Bounded-memory histogram builder.  Samples are buffered as packed
+ * (column,row) keys.  Whenever the buffer fills, it's sorted, merged into
+ * (column,row,count) triples, and spilled to a temporary file as a run.
+ * Runs are merged at most BSC_EXT_FANIN at a time: whenever that many runs
+ * of one level pile up, they're merged into a single run of the next level.
+ * Finishing merges the remaining runs straight into a normalised CSC
+ * matrix, so only the buffer, the row totals and the result are ever held
+ * in memory. */
+typedef struct bsc_ext {
+    uint64_t *buf;          /* Unsorted keys, (column << 32) | row. */
+    size_t fill, size;
+    char *dir;              /* Where runs are created. */
+    FILE **runs;            /* Spilled runs, already unlinked. */
+    int *levels;            /* Merge passes each run has been through. */
+    int nruns;
+    int *row_total;         /* Totals by (allocated) row. */
+    int end_row, end_col;
+    int64_t total;
+} bsc_ext_t;
+
 /*** Compressed-Sparse-Column Matrices. ***/
 
 #define CSC_MAX_STRIDE 7
 #define CSC_MAX_SPAN 7
-#define CSC_VERSION 1
+/* Version 2 pads each serialised section to start on a CSC_SECTION_ALIGN
+ * boundary, so that a file can be mapped and used in place. */
+#define CSC_VERSION 2
 #define CSC_MAGIC "CSC_MATRIXLE"
+#define CSC_MAGIC_LEN 12
+#define CSC_HEADER_LEN (CSC_MAGIC_LEN + 4 * sizeof(int32_t) + sizeof(int64_t))
+#define CSC_SECTION_ALIGN 4096
 
 #define CSC_M_STRIDERADIX 0x7
 #define CSC_F_CFREE       0x8
@@ -87,6 +140,11 @@ typedef struct csc_matrix {
     float *entries; /* Entry values (size nnz) */
 
     uint32_t *row_size; /*the size of each row*/ 
+
+    /* Not serialised.  If non-NULL, the arrays above point into this
+     * read-only mapping of a file, rather than being allocated. */
+    void *map;
+    size_t map_len;
 } csc_mat_t;
 
 /* A vector, stored densely. */
@@ -101,6 +159,7 @@ typedef enum {
     E_CSC_BADMAGIC = 2,
     /* Pass through libc errno. */
     E_CSC_ERRNO    = 3,
+    E_CSC_BADVER   = 4,
     E_CSC_COUNT
 } csc_errno_t;
 
@@ -121,6 +180,21 @@ void bsc_extend(bsc_hist_t *M, int c);
 void bsc_extend_col(bsc_hist_t *M, int c, int r);
 /* Count samples. Calls bsc_extend and bsc_extend_col as required. */
 void bsc_hist_count(bsc_hist_t *M, int c, int r, int n);
+/* Start a parallel build with n worker threads. */
+bsc_par_t *bsc_par_new(int n);
+/* Count a single sample. */
+void bsc_par_count(bsc_par_t *P, int c, int r);
+/* Wait for all counting to finish, merge the shards, and return the
+ * resulting histogram.  Destroys P. */
+bsc_hist_t *bsc_par_finish(bsc_par_t *P);
+/* Start a bounded-memory build, buffering up to 'budget' bytes of samples
+ * and spilling runs into 'dir' (or $TMPDIR, or /tmp, if NULL). */
+bsc_ext_t *bsc_ext_new(size_t budget, const char *dir);
+/* Count a single sample. */
+void bsc_ext_count(bsc_ext_t *X, int c, int r);
+/* Merge the runs into a matrix, as bsc_normalise would have produced from
+ * the same samples.  Destroys X. */
+csc_mat_t *bsc_ext_finish(bsc_ext_t *X);
 /* Generate a CSC matrix by normalising such that each row sums to 1. */
 csc_mat_t *bsc_normalise(bsc_hist_t *H);
 /* Return size (in bytes). */
@@ -138,6 +212,12 @@ void csc_mat_destroy(csc_mat_t *M);
 csc_errno_t csc_store_binary(csc_mat_t *M, FILE *f);
 /* De-serialise from fd f */
 csc_mat_t *csc_load_binary(FILE *f, csc_errno_t *e);
+/* Map a serialised matrix read-only from fd f, without copying, so that
+ * processes can share one copy in the page cache.  Falls back to
+ * csc_load_binary for streams and version 1 files.  Other than
+ * csc_prune_cols, the in-place transformations can't be applied to a mapped
+ * matrix. */
+csc_mat_t *csc_map_binary(FILE *f, csc_errno_t *e);
 /* Stride the matrix, by interleaving r_stride adjacent columns. */
 void csc_stride(csc_mat_t *M, int r_stride);
 /* Left-multiply A by dense row vector x, storing in y. y = x * A.  y must be